@@ -0,0 +1,91 @@
+/*
+Copyright 2025 The goARRG Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#ifndef __cplusplus
+#error C++ only header
+#endif
+
+#include <type_traits>
+
+namespace vkm::std {
+enum class memoryOrder : int {
+	relaxed = __ATOMIC_RELAXED,
+	acquire = __ATOMIC_ACQUIRE,
+	release = __ATOMIC_RELEASE,
+	acqRel = __ATOMIC_ACQ_REL,
+	seqCst = __ATOMIC_SEQ_CST,
+};
+
+template <typename T>
+class atomic {
+   private:
+	static_assert(::std::is_trivially_copyable_v<T>);
+	alignas(sizeof(T)) T value = T();
+
+   public:
+	atomic(const atomic&) = delete;
+	atomic& operator=(const atomic&) = delete;
+
+	constexpr atomic() noexcept = default;
+	constexpr atomic(T value) noexcept : value(value) {}
+
+	[[nodiscard]] T load(memoryOrder order = memoryOrder::seqCst) const noexcept {
+		return __atomic_load_n(&this->value, static_cast<int>(order));
+	}
+	void store(T desired, memoryOrder order = memoryOrder::seqCst) noexcept {
+		__atomic_store_n(&this->value, desired, static_cast<int>(order));
+	}
+	T exchange(T desired, memoryOrder order = memoryOrder::seqCst) noexcept {
+		return __atomic_exchange_n(&this->value, desired, static_cast<int>(order));
+	}
+	// on failure expected is updated to the current value
+	bool compareExchangeWeak(T& expected, T desired, memoryOrder success = memoryOrder::seqCst,
+							 memoryOrder failure = memoryOrder::seqCst) noexcept {
+		return __atomic_compare_exchange_n(&this->value, &expected, desired, true, static_cast<int>(success),
+										   static_cast<int>(failure));
+	}
+	bool compareExchangeStrong(T& expected, T desired, memoryOrder success = memoryOrder::seqCst,
+							   memoryOrder failure = memoryOrder::seqCst) noexcept {
+		return __atomic_compare_exchange_n(&this->value, &expected, desired, false, static_cast<int>(success),
+										   static_cast<int>(failure));
+	}
+	T fetchAdd(T v, memoryOrder order = memoryOrder::seqCst) noexcept
+		requires ::std::is_integral_v<T>
+	{
+		return __atomic_fetch_add(&this->value, v, static_cast<int>(order));
+	}
+	T fetchSub(T v, memoryOrder order = memoryOrder::seqCst) noexcept
+		requires ::std::is_integral_v<T>
+	{
+		return __atomic_fetch_sub(&this->value, v, static_cast<int>(order));
+	}
+};
+
+inline static void atomicThreadFence(memoryOrder order) noexcept {
+	__atomic_thread_fence(static_cast<int>(order));
+}
+
+// hint to the cpu that we are in a spin loop
+inline static void cpuRelax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#endif
+}
+}  // namespace vkm::std
@@ -0,0 +1,122 @@
+/*
+Copyright 2025 The goARRG Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#ifndef __cplusplus
+#error C++ only header
+#endif
+
+#include <pthread.h>
+
+#include "stdlib.hpp"
+
+namespace vkm::std {
+class mutex {
+   private:
+	pthread_mutex_t m = PTHREAD_MUTEX_INITIALIZER;
+
+	friend class conditionVariable;
+
+   public:
+	mutex(const mutex&) = delete;
+	mutex& operator=(const mutex&) = delete;
+
+	constexpr mutex() noexcept = default;
+	~mutex() noexcept { pthread_mutex_destroy(&this->m); }
+
+	void lock() noexcept {
+		if (pthread_mutex_lock(&this->m) != 0) {
+			abort("Failed to lock mutex");
+		}
+	}
+	[[nodiscard]] bool tryLock() noexcept { return pthread_mutex_trylock(&this->m) == 0; }
+	void unlock() noexcept {
+		if (pthread_mutex_unlock(&this->m) != 0) {
+			abort("Failed to unlock mutex");
+		}
+	}
+};
+
+class conditionVariable {
+   private:
+	pthread_cond_t c = PTHREAD_COND_INITIALIZER;
+
+   public:
+	conditionVariable(const conditionVariable&) = delete;
+	conditionVariable& operator=(const conditionVariable&) = delete;
+
+	constexpr conditionVariable() noexcept = default;
+	~conditionVariable() noexcept { pthread_cond_destroy(&this->c); }
+
+	// m must be locked by the caller, spurious wakeups are possible
+	void wait(mutex& m) noexcept {
+		if (pthread_cond_wait(&this->c, &m.m) != 0) {
+			abort("Failed to wait on condition variable");
+		}
+	}
+	void signal() noexcept { pthread_cond_signal(&this->c); }
+	void broadcast() noexcept { pthread_cond_broadcast(&this->c); }
+};
+
+class thread {
+   private:
+	pthread_t t = {};
+	bool running = false;
+	void (*fn)(void*) = nullptr;
+	void* data = nullptr;
+
+	static void* entry(void* self) noexcept {
+		auto* t = static_cast<thread*>(self);
+		t->fn(t->data);
+		return nullptr;
+	}
+
+   public:
+	// the thread refers to itself while running so it can be neither copied nor moved
+	thread(const thread&) = delete;
+	thread& operator=(const thread&) = delete;
+
+	constexpr thread() noexcept = default;
+	~thread() noexcept {
+		if (this->running) {
+			abort("Thread destroyed without being joined");
+		}
+	}
+
+	void start(void (*fn)(void*), void* data) noexcept {
+		if (this->running) {
+			abort("Thread already started");
+		}
+		this->fn = fn;
+		this->data = data;
+		if (pthread_create(&this->t, nullptr, entry, this) != 0) {
+			abort("Failed to create thread");
+		}
+		this->running = true;
+	}
+	void join() noexcept {
+		if (!this->running) {
+			return;
+		}
+		if (pthread_join(this->t, nullptr) != 0) {
+			abort("Failed to join thread");
+		}
+		this->running = false;
+	}
+	[[nodiscard]] bool joinable() const noexcept { return this->running; }
+};
+}  // namespace vkm::std
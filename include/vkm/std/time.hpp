@@ -21,6 +21,7 @@ limitations under the License.
 #endif
 
 #include <stdint.h>
+#include <time.h>
 
 namespace vkm::std::time {
 using duration = uint64_t;
@@ -30,4 +31,11 @@ using duration = uint64_t;
 [[maybe_unused]] static constexpr duration second = 1000 * millisecond;
 [[maybe_unused]] static constexpr duration minute = 60 * second;
 [[maybe_unused]] static constexpr duration hour = 60 * minute;
+
+// monotonic clock, only meaningful when compared against another call to now
+[[nodiscard]] inline static duration now() noexcept {
+	timespec ts = {};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<duration>(ts.tv_sec) * second + static_cast<duration>(ts.tv_nsec);
+}
 }  // namespace vkm::std::time
@@ -47,6 +47,9 @@ VKM_HANDLE(vkm_device);
 VKM_HANDLE(vkm_allocation);
 VKM_HANDLE(vkm_swapchain);
 VKM_HANDLE(vkm_context);
+VKM_HANDLE(vkm_uploader);
+VKM_HANDLE(vkm_bufferArena);
+VKM_HANDLE(vkm_sparseBinder);
 
 typedef enum {
 	VKM_LOG_LEVEL_VERBOSE,
@@ -56,6 +59,17 @@ typedef enum {
 	VKM_LOG_LEVEL_MAX_ENUM = 0x7FFFFFFF,
 } vkm_logLevel;
 
+typedef enum {
+	// cached and coherent, suits reading back and random access
+	VKM_HOST_ACCESS_CACHED,
+	// cached but possibly not coherent, writes must be flushed and reads invalidated
+	VKM_HOST_ACCESS_CACHED_NON_COHERENT,
+	// uncached write combined and possibly not coherent, the fastest way to stream sequential writes to the device
+	// but very slow to read from the host. writes must be flushed
+	VKM_HOST_ACCESS_WRITE_COMBINED,
+	VKM_HOST_ACCESS_MAX_ENUM = 0x7FFFFFFF,
+} vkm_hostAccess;
+
 typedef void (*vkm_loggerFn)(vkm_logLevel, size_t numTags, const vkm_string* tags, vkm_string message);
 
 typedef struct {
@@ -110,6 +124,12 @@ typedef struct {
 	uint32_t count;
 } vkm_initializer_queueInfo;
 
+typedef struct {
+	uint32_t family;
+	// the queue in family created for the sparse binder alone
+	uint32_t index;
+} vkm_initializer_sparseQueueInfo;
+
 typedef struct {
 	VkPhysicalDevice vkPhysicalDevice;
 	VkDevice vkDevice;
@@ -118,6 +138,17 @@ typedef struct {
 	VkBool32 gainOwnership;
 	struct {
 		VkBool32 extSwapchainMaint1;
+		// VkPhysicalDeviceVulkan12Features::hostQueryReset, required for vkm_context timestamps
+		VkBool32 hostQueryReset;
+		// VK_EXT_memory_priority, allocations get the priority given at creation
+		VkBool32 extMemoryPriority;
+		// VK_EXT_pageable_device_local_memory, required for vkm_device_setAllocationPriority
+		VkBool32 extPageableDeviceLocalMemory;
+		// VkPhysicalDeviceFeatures sparse features, sparseBinding is required for vkm_sparseBinder
+		VkBool32 sparseBinding;
+		VkBool32 sparseResidencyBuffer;
+		VkBool32 sparseResidencyImage2D;
+		VkBool32 sparseResidencyImage3D;
 	} optionalFeatures;
 } vkm_deviceInitInfo;
 
@@ -221,6 +252,47 @@ typedef struct {
 #undef VKM_VKFN
 } vkm_device_dispatchTable;
 
+typedef struct {
+	// ns to spin on the semaphore counters before falling back to a blocking wait,
+	// 0 blocks right away unless the values are already reached
+	uint64_t spinBudget;
+} vkm_device_waitPolicy;
+
+typedef struct {
+	// the values were already reached when the wait started
+	uint64_t alreadyReached;
+	// reached while spinning
+	uint64_t spinWins;
+	// fell back to vkWaitSemaphores
+	uint64_t blockingWaits;
+	uint64_t timeouts;
+} vkm_device_waitStats;
+
+typedef struct {
+	VkMemoryHeapFlags flags;
+	// bytes used by the whole process as reported by VK_EXT_memory_budget, including memory not allocated through vkm
+	VkDeviceSize usage;
+	// bytes the process can use before the driver may start paging
+	VkDeviceSize budget;
+	// VkDeviceMemory blocks allocated through vkm and the bytes they take
+	uint32_t blockCount;
+	VkDeviceSize blockBytes;
+	// allocations suballocated from those blocks and the bytes they take
+	uint32_t allocationCount;
+	VkDeviceSize allocationBytes;
+} vkm_device_heapBudget;
+
+typedef void (*vkm_device_memoryWatermarkCallback)(void* userdata, uint32_t heapIndex, vkm_device_heapBudget, VkBool32 above);
+
+typedef struct {
+	// fraction of a heap's budget, the callback runs when usage rises to or falls below threshold * budget
+	float threshold;
+	// heaps to watch, 0 watches every heap
+	uint32_t heapMask;
+	vkm_device_memoryWatermarkCallback fn;
+	void* userdata;
+} vkm_device_memoryWatermark;
+
 typedef struct {
 	vkm_allocation allocation;
 	VkBuffer vkBuffer;
@@ -232,11 +304,34 @@ typedef struct {
 	VkBuffer vkBuffer;
 } vkm_deviceBuffer;
 
+typedef struct {
+	VkBuffer vkBuffer;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	// already offset, points to the start of the range
+	void* ptr;
+} vkm_hostBufferRange;
+
+typedef struct {
+	vkm_allocation allocation;
+	VkBuffer vkBuffer;
+	// mapped device local memory, null if the buffer fell back to device memory that is written through staging
+	void* ptr;
+} vkm_barBuffer;
+
 typedef struct {
 	vkm_allocation allocation;
 	VkImage vkImage;
 } vkm_image;
 
+typedef struct {
+	VkImageCreateInfo info;
+	// first and last use of the image, inclusive, in any unit that increases through the frame such as a pass index.
+	// images whose ranges do not overlap may share memory
+	uint32_t firstUse;
+	uint32_t lastUse;
+} vkm_aliasedImageInfo;
+
 typedef struct {
 	VkSurfaceKHR targetSurface;
 	VkExtent2D extent;
@@ -288,6 +383,18 @@ typedef struct {
 	VkResult* pResult;
 } vkm_swapchain_presentInfo;
 
+typedef struct {
+	// per frame, allocated from the frame's command pool
+	uint32_t numCommandBuffers;
+	// per frame and per thread pool
+	uint32_t numThreadPrimaryCommandBuffers;
+	uint32_t numThreadSecondaryCommandBuffers;
+	// per frame, binary semaphores are shared by the device so these are added to its free list
+	uint32_t numBinarySemaphores;
+	// fences are shared by the device and held per swapchain image so this is a device wide total not per frame
+	uint32_t numFences;
+} vkm_context_prewarmInfo;
+
 typedef struct {
 	uint32_t queueFamily;
 	uint32_t queueIndex;
@@ -297,9 +404,115 @@ typedef struct {
 		const void* pNext;
 		VkCommandPoolCreateFlags flags;
 	} commandPoolCreateInfo;
+	struct {
+		// if != 0, every frame owns persistently mapped host buffers of at least this size
+		// that vkm_context_allocateScratchHostBuffer suballocates from
+		VkDeviceSize blockSize;
+		// usage of every block, always includes VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+		VkBufferUsageFlags usage;
+	} scratchBlockCreateInfo;
+	// if true, vkm_context_endCommandBuffer only records the submit and presents,
+	// they are submitted together in one vkQueueSubmit2 on vkm_context_flush or vkm_context_end
+	VkBool32 deferSubmit;
+	// number of extra command pools per frame for vkm_context_beginThreadCommandBuffer,
+	// each created with commandPoolCreateInfo
+	uint32_t numThreadPools;
+	// if true, destroyers of a frame are handed to a background thread owned by the context once the frame
+	// has been waited on instead of running inline in vkm_context_begin, destroyers must then be thread safe
+	VkBool32 backgroundDestroyers;
+	// if != 0, every frame owns a timestamp query pool with room for this many scopes,
+	// including the one automatically placed around every command buffer from vkm_context_beginCommandBuffer.
+	// requires vkm_deviceInitInfo.optionalFeatures.hostQueryReset
+	uint32_t maxTimestampScopes;
+	// objects created up front so the first frames don't create them one at a time,
+	// vkm_context_getHighWaterMarks of an earlier run is a good value
+	vkm_context_prewarmInfo prewarm;
 } vkm_contextCreateInfo;
 
+#define VKM_UPLOADER_DEFAULT_STAGING_SIZE (64ull * 1024 * 1024)
+
+typedef struct {
+	// usually the queue from vkm_initializer_getTransferQueueInfo
+	uint32_t queueFamily;
+	uint32_t queueIndex;
+	// size of the persistently mapped staging ring, defaults to VKM_UPLOADER_DEFAULT_STAGING_SIZE if 0
+	VkDeviceSize stagingSize;
+} vkm_uploaderCreateInfo;
+
+typedef struct {
+	VkDeviceSize size;
+	VkBufferUsageFlags usage;
+	// if true the arena is persistently mapped host memory, otherwise it is device local
+	VkBool32 hostVisible;
+} vkm_bufferArenaCreateInfo;
+
+typedef struct {
+	// internal, identifies the slice within the arena
+	vkm_allocation allocation;
+	VkBuffer vkBuffer;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	// already offset, null for device local arenas
+	void* ptr;
+} vkm_bufferSlice;
+
+typedef struct {
+	uint32_t sliceCount;
+	VkDeviceSize usedBytes;
+	VkDeviceSize freeBytes;
+	uint32_t freeRangeCount;
+	VkDeviceSize largestFreeRange;
+	// 0 when the free bytes form a single range, approaches 1 as they get scattered into small ranges
+	float fragmentation;
+} vkm_bufferArenaStats;
+
+#define VKM_SPARSE_BINDER_DEFAULT_BLOCK_SIZE (64ull * 1024 * 1024)
+
+typedef struct {
+	// usually the queue from vkm_initializer_getSparseQueueInfo
+	uint32_t queueFamily;
+	uint32_t queueIndex;
+	// size of the VkDeviceMemory blocks tiles are suballocated from,
+	// defaults to VKM_SPARSE_BINDER_DEFAULT_BLOCK_SIZE if 0
+	VkDeviceSize blockSize;
+} vkm_sparseBinderCreateInfo;
+
+typedef struct {
+	// internal, the page table of the buffer
+	vkm_allocation allocation;
+	VkBuffer vkBuffer;
+	// commit and evict work on whole pages of this size
+	VkDeviceSize pageSize;
+} vkm_sparseBuffer;
+
+typedef struct {
+	// internal, the page table of the image
+	vkm_allocation allocation;
+	VkImage vkImage;
+	// commit and evict work on whole tiles of this extent
+	VkExtent3D tileExtent;
+	// mip levels from here on are packed into the mip tail which is committed for a whole layer at once
+	uint32_t mipTailFirstLod;
+} vkm_sparseImage;
+
+typedef struct {
+	uint32_t mipLevel;
+	uint32_t arrayLayer;
+	VkOffset3D offset;
+	// a zero width covers the whole mip level
+	VkExtent3D extent;
+} vkm_sparseImageRegion;
+
+typedef struct {
+	// bytes of tiles currently committed, including evicted tiles whose unbind has not completed
+	VkDeviceSize committedBytes;
+	// bytes of VkDeviceMemory held by the tile pools
+	VkDeviceSize poolBytes;
+	uint32_t pendingBinds;
+} vkm_sparseBinderStats;
+
 typedef void (*vkm_destroyFn)(void*);
+typedef void (*vkm_semaphore_timeline_callback)(void* userdata, VkSemaphore, uint64_t value);
 
 typedef struct {
 	vkm_destroyFn fn;
@@ -307,9 +520,97 @@ typedef struct {
 	void* data;
 } vkm_destroyer;
 
+typedef enum {
+	// waiting in vkm_context_begin for the frame slot
+	VKM_CONTEXT_PHASE_BEGIN_WAIT,
+	// running destroyers and releasing retired resources in vkm_context_begin
+	VKM_CONTEXT_PHASE_DESTROYERS,
+	// resetting the frame's command pools in vkm_context_begin
+	VKM_CONTEXT_PHASE_COMMAND_POOL_RESET,
+	// vkQueueSubmit2
+	VKM_CONTEXT_PHASE_SUBMIT,
+	// presenting a single swapchain
+	VKM_CONTEXT_PHASE_PRESENT,
+	VKM_CONTEXT_PHASE_COUNT,
+	VKM_CONTEXT_PHASE_MAX_ENUM = 0x7FFFFFFF,
+} vkm_context_phase;
+
+// size of the per phase sample ring
+#define VKM_CONTEXT_PHASE_MAX_SAMPLES 256
+
+typedef struct {
+	// number of samples aggregated, at most VKM_CONTEXT_PHASE_MAX_SAMPLES
+	uint32_t count;
+	// nanoseconds
+	uint64_t min;
+	uint64_t avg;
+	uint64_t p99;
+	uint64_t max;
+} vkm_context_phaseStats;
+
+typedef struct {
+	char name[64];
+	// 0 for command buffers, nested scopes are one deeper than the scope they were begun in
+	uint32_t depth;
+	// nanoseconds since the earliest timestamp of the frame
+	uint64_t start;
+	// nanoseconds
+	uint64_t duration;
+} vkm_context_timestampResult;
+
+typedef struct {
+	// timeline semaphore signaled by the submission
+	VkSemaphore vkSemaphore;
+	// the submission is complete once vkSemaphore reaches value
+	uint64_t value;
+} vkm_completionToken;
+
+typedef struct {
+	// VK_OBJECT_TYPE_BUFFER or VK_OBJECT_TYPE_IMAGE
+	VkObjectType objectType;
+	// unchanged by the move, identifies the vkm_deviceBuffer or vkm_image
+	vkm_allocation allocation;
+	VkBuffer oldBuffer;
+	VkBuffer newBuffer;
+	VkImage oldImage;
+	VkImage newImage;
+} vkm_context_defragMove;
+
+// runs while recording cb, from then on the new handle must be used in place of the old one which is destroyed once
+// the pass completes. buffers have already been copied, images are left in VK_IMAGE_LAYOUT_UNDEFINED and the callback
+// must record their copy including the layout transitions of both images
+typedef void (*vkm_context_defragCallback)(void* userdata, VkCommandBuffer cb, const vkm_context_defragMove*);
+
+typedef struct {
+	// 0 means no limit
+	VkDeviceSize maxBytesPerPass;
+	// 0 means no limit
+	uint32_t maxMovesPerPass;
+	vkm_context_defragCallback fn;
+	void* userdata;
+} vkm_context_defragInfo;
+
+typedef struct {
+	VkDeviceSize bytesMoved;
+	VkDeviceSize bytesFreed;
+	uint32_t allocationsMoved;
+	uint32_t deviceMemoryBlocksFreed;
+} vkm_context_defragStats;
+
+typedef struct {
+	// reached once the copy has completed, poll or wait on it with vkm_completionToken_poll/wait
+	vkm_completionToken token;
+	VkDeviceSize size;
+	// internal, identifies the pooled readback buffer and which use of it the ticket is for
+	uint32_t slot;
+	uint32_t generation;
+} vkm_readbackTicket;
+
 typedef struct {
 	const void* pNext;
 	VkCommandBufferUsageFlags flags;
+	// required for secondary command buffers, ignored for primary
+	const VkCommandBufferInheritanceInfo* pInheritanceInfo;
 } vkm_context_commandBufferBeginInfo;
 
 typedef struct {
@@ -359,6 +660,11 @@ extern VKM_FN void vkm_initializer_findPresentationSupport(vkm_initializer, VkSu
 extern VKM_FN void vkm_initializer_findGraphicsQueue(vkm_initializer, vkm_initializer_queueCreateInfo);
 extern VKM_FN void vkm_initializer_findComputeQueue(vkm_initializer, vkm_initializer_queueCreateInfo);
 extern VKM_FN void vkm_initializer_findTransferQueue(vkm_initializer, vkm_initializer_queueCreateInfo);
+// requires VkPhysicalDeviceFeatures::sparseBinding and that one of the graphics, compute or transfer queue families
+// found supports VK_QUEUE_SPARSE_BINDING_BIT and has a queue left, preferring transfer then compute then graphics.
+// one more queue is created in that family for the sparse binder.
+// the sparse residency features are enabled when present
+extern VKM_FN void vkm_initializer_findSparseQueue(vkm_initializer);
 
 // this can be called without vkm_initializer_createInstance, for situations where you want to create the instance
 // yourself, returns VK_ERROR_EXTENSION_NOT_PRESENT if not every required extension was found
@@ -380,6 +686,9 @@ extern VKM_FN void vkm_initializer_getEnabledFeatures(vkm_initializer, void*);
 extern VKM_FN void vkm_initializer_getGraphicsQueueInfo(vkm_initializer, vkm_initializer_queueInfo*);
 extern VKM_FN void vkm_initializer_getComputeQueueInfo(vkm_initializer, vkm_initializer_queueInfo*);
 extern VKM_FN void vkm_initializer_getTransferQueueInfo(vkm_initializer, vkm_initializer_queueInfo*);
+// the family is that of one of the queues above and index is the count reported for it, as the extra queue is created
+// after the others no context or uploader created from the queue infos above shares it
+extern VKM_FN void vkm_initializer_getSparseQueueInfo(vkm_initializer, vkm_initializer_sparseQueueInfo*);
 // reject reasons only available for tried devices, devices that are sorted after the selected device will not appear,
 extern VKM_FN void vkm_initializer_getRejectReasons(vkm_initializer, size_t*, vkm_initializer_rejectReason*);
 
@@ -391,26 +700,87 @@ extern VKM_FN void vkm_device_getProperties(vkm_device, vkm_device_properties*);
 extern VKM_FN PFN_vkVoidFunction vkm_device_getProcAddr(vkm_device, vkm_device_vkfn_id);
 extern VKM_FN void vkm_device_getDispatchTable(vkm_device, vkm_device_dispatchTable*);
 extern VKM_FN VkResult vkm_device_waitIdle(vkm_device);
+// applies to every timeline semaphore wait done through vkm on the device, including the context's begin and wait
+extern VKM_FN void vkm_device_setWaitPolicy(vkm_device, vkm_device_waitPolicy);
+extern VKM_FN void vkm_device_getWaitStats(vkm_device, vkm_device_waitStats*);
+// if pBudgets is null only *pCount is written, otherwise writes up to *pCount heaps
+extern VKM_FN void vkm_device_getMemoryBudget(vkm_device, uint32_t* pCount, vkm_device_heapBudget* pBudgets);
+// replaces every watermark, count 0 removes them all. watermarks are evaluated at vkm_context_begin of any context
+// on the device, so callbacks run on that thread and must not call vkm_device_setMemoryWatermarks.
+// heaps already above a new watermark report it on the next evaluation
+extern VKM_FN void vkm_device_setMemoryWatermarks(vkm_device, uint32_t count, const vkm_device_memoryWatermark*);
+// changes the priority of the VkDeviceMemory backing the allocation, priority is in [0, 1].
+// returns VK_ERROR_FEATURE_NOT_PRESENT without VK_EXT_pageable_device_local_memory, and VK_ERROR_NOT_PERMITTED_KHR
+// if the allocation does not own its VkDeviceMemory, create it with a priority other than 0.5 to get one that does
+extern VKM_FN VkResult vkm_device_setAllocationPriority(vkm_device, vkm_allocation, float priority);
 
 extern VKM_FN void vkm_createTimelineSemaphore(vkm_device, vkm_string, uint64_t initialValue, VkSemaphore*);
 extern VKM_FN void vkm_destroyTimelineSemaphore(vkm_device, VkSemaphore);
+extern VKM_FN VkBool32 vkm_completionToken_poll(vkm_device, vkm_completionToken);
+// returns VK_SUCCESS or VK_TIMEOUT
+extern VKM_FN VkResult vkm_completionToken_wait(vkm_device, vkm_completionToken, uint64_t timeout);
+
 extern VKM_FN void vkm_semaphore_timeline_signal(vkm_device, VkSemaphore, uint64_t);
 extern VKM_FN void vkm_semaphore_timeline_wait(vkm_device, VkSemaphore, uint64_t);
+// waits until every semaphore, or any if flags has VK_SEMAPHORE_WAIT_ANY_BIT, reaches its value.
+// returns VK_SUCCESS or VK_TIMEOUT
+extern VKM_FN VkResult vkm_semaphore_timeline_waitMany(vkm_device, size_t count, const VkSemaphore*, const uint64_t* values,
+													   VkSemaphoreWaitFlags, uint64_t timeout);
 extern VKM_FN uint64_t vkm_semaphore_timeline_getValue(vkm_device, VkSemaphore);
+// calls callback on a thread owned by the device once the semaphore reaches value, callbacks that become ready together
+// are called in value order. the semaphore must outlive the callback and callbacks must be short as they delay each other.
+// callbacks not yet reached when the device is destroyed are never called
+extern VKM_FN void vkm_semaphore_timeline_onReached(vkm_device, VkSemaphore, uint64_t value, vkm_semaphore_timeline_callback,
+												   void* userdata);
 
 extern VKM_FN void vkm_createHostBuffer(vkm_device, vkm_string, VkBufferCreateInfo, vkm_hostBuffer*);
 extern VKM_FN void vkm_destroyHostBuffer(vkm_device, vkm_hostBuffer);
+// same as vkm_createHostBuffer with VKM_HOST_ACCESS_CACHED
+extern VKM_FN void vkm_createHostBuffer2(vkm_device, vkm_string, VkBufferCreateInfo, vkm_hostAccess, vkm_hostBuffer*);
+// large writes into write combined memory use non temporal stores where the cpu supports them
 extern VKM_FN void vkm_hostBuffer_write(vkm_device, vkm_hostBuffer, size_t off, size_t sz, void*);
 extern VKM_FN void vkm_hostBuffer_read(vkm_device, vkm_hostBuffer, size_t off, size_t sz, void*);
+// makes host writes to the range visible to the device, a no-op on coherent memory
+extern VKM_FN void vkm_hostBuffer_flush(vkm_device, vkm_hostBuffer, VkDeviceSize off, VkDeviceSize sz);
+// makes device writes to the range visible to the host, a no-op on coherent memory
+extern VKM_FN void vkm_hostBuffer_invalidate(vkm_device, vkm_hostBuffer, VkDeviceSize off, VkDeviceSize sz);
 
 extern VKM_FN void vkm_createDeviceBuffer(vkm_device, vkm_string, VkBufferCreateInfo, vkm_deviceBuffer*);
 extern VKM_FN void vkm_destroyDeviceBuffer(vkm_device, vkm_deviceBuffer);
+// priority is in [0, 1] and used when the device has VK_EXT_memory_priority. vkm_createDeviceBuffer uses 0.5,
+// any other priority gets its own VkDeviceMemory so it does not affect other resources
+extern VKM_FN void vkm_createDeviceBuffer2(vkm_device, vkm_string, VkBufferCreateInfo, float priority,
+										   vkm_deviceBuffer*);
+
+// batched versions of the functions above, names may be null. memory for runs of infos with identical requirements
+// is allocated in one go. failures do not abort, results[i] is set for every item and failed items are zeroed.
+// the destroy functions skip zeroed items
+extern VKM_FN void vkm_createHostBuffers(vkm_device, uint32_t count, const vkm_string* names, const VkBufferCreateInfo*,
+										 vkm_hostBuffer*, VkResult* results);
+extern VKM_FN void vkm_destroyHostBuffers(vkm_device, uint32_t count, const vkm_hostBuffer*);
+extern VKM_FN void vkm_createDeviceBuffers(vkm_device, uint32_t count, const vkm_string* names, const VkBufferCreateInfo*,
+										   vkm_deviceBuffer*, VkResult* results);
+extern VKM_FN void vkm_destroyDeviceBuffers(vkm_device, uint32_t count, const vkm_deviceBuffer*);
 
 extern VKM_FN void vkm_getFormatProperties3(vkm_device, VkFormat, VkFormatProperties3*);
 extern VKM_FN VkResult vkm_getImageFormatProperties2(vkm_device, VkPhysicalDeviceImageFormatInfo2, VkImageFormatProperties2*);
 extern VKM_FN VkBool32 vkm_getFormatHasImageUsageFlags(vkm_device, VkFormat, VkImageUsageFlags);
 extern VKM_FN void vkm_createImage(vkm_device, vkm_string, VkImageCreateInfo, vkm_image*);
 extern VKM_FN void vkm_destroyImage(vkm_device, vkm_image);
+// see vkm_createDeviceBuffer2
+extern VKM_FN void vkm_createImage2(vkm_device, vkm_string, VkImageCreateInfo, float priority, vkm_image*);
+// see vkm_createDeviceBuffers
+extern VKM_FN void vkm_createImages(vkm_device, uint32_t count, const vkm_string* names, const VkImageCreateInfo*, vkm_image*,
+									VkResult* results);
+extern VKM_FN void vkm_destroyImages(vkm_device, uint32_t count, const vkm_image*);
+// info.usage may only contain attachment usages, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT is added.
+// uses lazily allocated memory if the device has it, otherwise regular device local memory. destroy with vkm_destroyImage
+extern VKM_FN void vkm_createTransientImage(vkm_device, vkm_string, VkImageCreateInfo, vkm_image*);
+// places the images in a single allocation, overlapping those whose uses do not overlap. the contents of an aliased image
+// are undefined at its first use so it must be transitioned from VK_IMAGE_LAYOUT_UNDEFINED every time
+extern VKM_FN void vkm_createAliasedImages(vkm_device, vkm_string, uint32_t count, const vkm_aliasedImageInfo*, vkm_image*);
+// destroys every image from one vkm_createAliasedImages call and their shared allocation
+extern VKM_FN void vkm_destroyAliasedImages(vkm_device, uint32_t count, const vkm_image*);
 
 extern VKM_FN void vkm_createImageView(vkm_device, vkm_string, VkImageViewCreateInfo, VkImageView*);
 extern VKM_FN void vkm_destroyImageView(vkm_device, VkImageView);
@@ -424,23 +794,177 @@ extern VKM_FN void vkm_swapchain_getProperties(vkm_swapchain, vkm_swapchain_prop
 extern VKM_FN VkResult vkm_swapchain_resize(vkm_swapchain, VkExtent2D);
 extern VKM_FN VkResult vkm_swapchain_changeVkPresentMode(vkm_swapchain, size_t, VkPresentModeKHR*, VkExtent2D);
 
+// the uploader owns its queue, nothing else may submit to it.
+// destination buffers used from another queue family must be VK_SHARING_MODE_CONCURRENT
+extern VKM_FN void vkm_createUploader(vkm_device, vkm_string, vkm_uploaderCreateInfo, vkm_uploader*);
+// submits anything pending and waits for every upload to complete
+extern VKM_FN void vkm_destroyUploader(vkm_uploader);
+// copies data into the staging ring and records a copy to dst, coalesced with neighbouring uploads to the same buffer.
+// blocks while the ring is full until older uploads complete. the token is reached once the copy completes
+// which is after the next vkm_uploader_flush, wait on it before using dst
+extern VKM_FN vkm_completionToken vkm_uploader_uploadBuffer(vkm_uploader, VkBuffer dst, VkDeviceSize dstOffset, VkDeviceSize size,
+															const void* data);
+// submits every pending upload in a single vkQueueSubmit2
+extern VKM_FN vkm_completionToken vkm_uploader_flush(vkm_uploader);
+
+// prefers device local host visible memory when the device exposes a BAR heap with budget left,
+// otherwise falls back to device local memory and adds VK_BUFFER_USAGE_TRANSFER_DST_BIT to info.usage
+extern VKM_FN void vkm_createBarBuffer(vkm_device, vkm_string, VkBufferCreateInfo, vkm_barBuffer*);
+extern VKM_FN void vkm_destroyBarBuffer(vkm_device, vkm_barBuffer);
+// writes straight into the mapped memory and returns an already reached token when the buffer is mapped,
+// otherwise goes through vkm_uploader_uploadBuffer with the same rules as it
+extern VKM_FN vkm_completionToken vkm_barBuffer_write(vkm_uploader, vkm_barBuffer, VkDeviceSize offset, VkDeviceSize size,
+													  const void* data);
+
+// one VkBuffer suballocated into slices, every function locks so an arena may be shared between threads
+extern VKM_FN void vkm_createBufferArena(vkm_device, vkm_string, vkm_bufferArenaCreateInfo, vkm_bufferArena*);
+// every slice must have been freed
+extern VKM_FN void vkm_destroyBufferArena(vkm_bufferArena);
+// the name is only kept in debug builds, if alignment is 0 slices are aligned to 1.
+// returns VK_ERROR_OUT_OF_DEVICE_MEMORY without touching the slice if the arena has no free range large enough
+extern VKM_FN VkResult vkm_bufferArena_allocate(vkm_bufferArena, vkm_string, VkDeviceSize size, VkDeviceSize alignment,
+												vkm_bufferSlice*);
+extern VKM_FN void vkm_bufferArena_free(vkm_bufferArena, const vkm_bufferSlice*);
+extern VKM_FN void vkm_bufferArena_getStats(vkm_bufferArena, vkm_bufferArenaStats*);
+
+// the binder owns its queue, nothing else may submit to it. every function locks so a binder may be shared between
+// threads. requires vkm_deviceInitInfo.optionalFeatures.sparseBinding
+extern VKM_FN void vkm_createSparseBinder(vkm_device, vkm_string, vkm_sparseBinderCreateInfo, vkm_sparseBinder*);
+// submits anything pending and waits for every bind to complete, every sparse resource must have been destroyed
+extern VKM_FN void vkm_destroySparseBinder(vkm_sparseBinder);
+// info.flags gets VK_BUFFER_CREATE_SPARSE_BINDING_BIT and VK_BUFFER_CREATE_SPARSE_RESIDENCY_BIT, no page is committed.
+// returns VK_ERROR_FEATURE_NOT_PRESENT without sparseResidencyBuffer
+extern VKM_FN VkResult vkm_createSparseBuffer(vkm_sparseBinder, vkm_string, VkBufferCreateInfo, vkm_sparseBuffer*);
+// waits for every submitted bind, pending binds of the buffer are dropped. the buffer must not be in use
+extern VKM_FN void vkm_destroySparseBuffer(vkm_sparseBinder, vkm_sparseBuffer);
+// queues binds for every uncommitted page overlapping the range,
+// they take effect after the next vkm_sparseBinder_flush.
+// returns VK_ERROR_OUT_OF_DEVICE_MEMORY if some pages could not be allocated, the others are still committed
+extern VKM_FN VkResult vkm_sparseBuffer_commit(vkm_sparseBinder, vkm_sparseBuffer, VkDeviceSize offset,
+											   VkDeviceSize size);
+// queues unbinds for every committed page overlapping the range, the device must be done with them by the time
+// the unbinds execute, use the waits of vkm_sparseBinder_flush for that. the memory is reused once the unbinds complete
+extern VKM_FN void vkm_sparseBuffer_evict(vkm_sparseBinder, vkm_sparseBuffer, VkDeviceSize offset, VkDeviceSize size);
+// info.flags gets VK_IMAGE_CREATE_SPARSE_BINDING_BIT and VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT, no tile is committed.
+// returns VK_ERROR_FEATURE_NOT_PRESENT without sparseResidencyImage2D or sparseResidencyImage3D for the image type and
+// VK_ERROR_FORMAT_NOT_SUPPORTED unless the format has a single color aspect sparse layout without metadata
+extern VKM_FN VkResult vkm_createSparseImage(vkm_sparseBinder, vkm_string, VkImageCreateInfo, vkm_sparseImage*);
+// see vkm_destroySparseBuffer
+extern VKM_FN void vkm_destroySparseImage(vkm_sparseBinder, vkm_sparseImage);
+// see vkm_sparseBuffer_commit, regions at or past mipTailFirstLod commit the mip tail of the layer
+extern VKM_FN VkResult vkm_sparseImage_commit(vkm_sparseBinder, vkm_sparseImage, vkm_sparseImageRegion);
+// see vkm_sparseBuffer_evict, regions at or past mipTailFirstLod evict the mip tail of the layer
+extern VKM_FN void vkm_sparseImage_evict(vkm_sparseBinder, vkm_sparseImage, vkm_sparseImageRegion);
+// submits every pending bind in a single vkQueueBindSparse that waits on the tokens first, null tokens are skipped.
+// the returned token is reached once the binds are done
+extern VKM_FN vkm_completionToken vkm_sparseBinder_flush(vkm_sparseBinder, uint32_t waitCount,
+														 const vkm_completionToken* waits);
+extern VKM_FN void vkm_sparseBinder_getStats(vkm_sparseBinder, vkm_sparseBinderStats*);
+
 extern VKM_FN void vkm_createContext(vkm_device, vkm_string, vkm_contextCreateInfo, vkm_context*);
 extern VKM_FN void vkm_destroyContext(vkm_context);
 
 extern VKM_FN VkBool32 vkm_context_getSwapchainPresentationSupport(vkm_context, vkm_swapchain);
 
 extern VKM_FN void vkm_context_begin(vkm_context, vkm_string);
+// same as vkm_context_begin but returns VK_NOT_READY without blocking if the frame is still in flight,
+// the context is only begun on VK_SUCCESS
+extern VKM_FN VkResult vkm_context_tryBegin(vkm_context, vkm_string);
+// same as vkm_context_begin but waits at most timeout nanoseconds for the frame and returns VK_TIMEOUT on expiry,
+// the context is only begun on VK_SUCCESS
+extern VKM_FN VkResult vkm_context_beginTimeout(vkm_context, vkm_string, uint64_t timeout);
 // marks object for destruction when this frame is done and waited on
 extern VKM_FN void vkm_context_queueDestroyer(vkm_context, vkm_destroyer);
+// blocks until every destroyer handed to the background thread has run,
+// a no-op unless the context was created with backgroundDestroyers
+extern VKM_FN void vkm_context_flushDestroyers(vkm_context);
+// marks object for destruction as soon as the submission of the token completes, token must come from this context
+extern VKM_FN void vkm_context_queueTokenDestroyer(vkm_context, vkm_completionToken, vkm_destroyer);
 // returns a host buffer that is only valid for the duration of the frame
 extern VKM_FN void vkm_context_createScratchHostBuffer(vkm_context, vkm_string, VkBufferCreateInfo, vkm_hostBuffer*);
+// destroys a buffer from vkm_context_createScratchHostBuffer created during the current frame as soon as
+// the submission of the token completes instead of at the end of the frame, token must come from this context
+extern VKM_FN void vkm_context_releaseScratchHostBuffer(vkm_context, const vkm_hostBuffer*, vkm_completionToken);
+// releases every resource retired by a token whose submission has completed,
+// vkm_context_begin calls this automatically
+extern VKM_FN void vkm_context_retire(vkm_context);
+// returns a range of the frame's scratch blocks that is only valid for the duration of the frame,
+// requires vkm_contextCreateInfo.scratchBlockCreateInfo.blockSize != 0.
+// if alignment is 0, defaults to the largest buffer offset alignment required by the device
+extern VKM_FN void vkm_context_allocateScratchHostBuffer(vkm_context, VkDeviceSize size, VkDeviceSize alignment, vkm_hostBufferRange*);
 // the next call to vkm_context_endCommandBuffer will wait on the acquire semaphore,
 // you cannot acquire from the same swapchain again until calling vkm_context_endCommandBuffer with this swapchain
+// (and vkm_context_flush if vkm_contextCreateInfo.deferSubmit is set)
 // passed in presentInfo, where it will signal the present semaphore, all other sync is the responsibility of the caller
 extern VKM_FN void vkm_context_acquireSwapchain(vkm_context, size_t, vkm_swapchain_acquireInfo*);
 // you can only have one command buffer active per context at any given time
 extern VKM_FN void vkm_context_beginCommandBuffer(vkm_context, vkm_string, vkm_context_commandBufferBeginInfo, VkCommandBuffer*);
-extern VKM_FN void vkm_context_endCommandBuffer(vkm_context, vkm_context_commandBufferEndInfo);
+// when vkm_contextCreateInfo.deferSubmit is set, the pNext chains in vkm_context_commandBufferEndInfo and
+// pPresentInfos[i].pResult must remain valid until the next vkm_context_flush, vkm_context_end or vkm_context_wait
+// returns a token that completes once the command buffer has finished executing,
+// binary semaphores waited on by the submit are recycled as soon as the token completes.
+// when vkm_contextCreateInfo.deferSubmit is set the token, and any readback ticket recorded into the command buffer,
+// cannot complete before the next vkm_context_flush or vkm_context_end and must not be waited on until then,
+// debug builds fatal on such a wait
+extern VKM_FN vkm_completionToken vkm_context_endCommandBuffer(vkm_context, vkm_context_commandBufferEndInfo);
+// begins a command buffer from the pool of threadIndex, threadIndex < vkm_contextCreateInfo.numThreadPools,
+// different thread indices may record concurrently, but each thread index must only be used by one thread at a time
+// and only between vkm_context_begin and vkm_context_end
+extern VKM_FN void vkm_context_beginThreadCommandBuffer(vkm_context, uint32_t threadIndex, vkm_string, VkCommandBufferLevel,
+														vkm_context_commandBufferBeginInfo, VkCommandBuffer*);
+extern VKM_FN void vkm_context_endThreadCommandBuffer(vkm_context, uint32_t threadIndex, VkCommandBuffer);
+// submits ended primary command buffers from any thread pool in the given order as one VkSubmitInfo2,
+// with the same semaphore, present and deferSubmit handling as vkm_context_endCommandBuffer.
+// must be called from the thread that calls vkm_context_begin/vkm_context_end,
+// secondary command buffers are executed through vkCmdExecuteCommands and must not be passed here
+extern VKM_FN vkm_completionToken vkm_context_submitThreadCommandBuffers(vkm_context, size_t, const VkCommandBuffer*,
+																		 vkm_context_commandBufferEndInfo);
+// writes a timestamp into the command buffer, scopes nest and must be ended in the command buffer they were begun in,
+// scopes beyond vkm_contextCreateInfo.maxTimestampScopes in a frame are dropped, a no-op if timestamps are disabled.
+// must be called from the thread that calls vkm_context_begin/vkm_context_end
+extern VKM_FN void vkm_context_beginTimestampScope(vkm_context, VkCommandBuffer, vkm_string);
+extern VKM_FN void vkm_context_endTimestampScope(vkm_context, VkCommandBuffer);
+// records a copy of src into a pooled host cached buffer at the end of the active command buffer,
+// preceded by a barrier making every earlier write visible to the copy.
+// the ticket is reached once the active command buffer completes, so it must be ended before any other submit
+extern VKM_FN void vkm_context_readbackBuffer(vkm_context, VkBuffer src, VkDeviceSize offset, VkDeviceSize size,
+											  vkm_readbackTicket*);
+// may be called from any thread, returns VK_NOT_READY if the copy has not completed yet instead of waiting.
+// the data stays valid until the ticket is released
+extern VKM_FN VkResult vkm_context_mapReadback(vkm_context, const vkm_readbackTicket*, const void** ppData);
+// may be called from any thread, returns the buffer to the pool. the ticket must have been reached
+extern VKM_FN void vkm_context_releaseReadback(vkm_context, const vkm_readbackTicket*);
+// runs one bounded pass of defragmentation over the memory of device buffers and images per call, call it once per frame
+// with a command buffer active. only resources created with VK_*_USAGE_TRANSFER_SRC_BIT | VK_*_USAGE_TRANSFER_DST_BIT
+// are moved and pNext of their create info is not kept. returns VK_INCOMPLETE while in progress and VK_SUCCESS once
+// done, writing stats if not null. the pass is ended by a later call after the active command buffer completes,
+// so it must be ended before any other submit. one context per device may defragment at a time.
+// the active command buffer waits for everything the other contexts and uploaders of the device have already sent to
+// their queues, so moved resources may be used by any of them before the pass but never by queues vkm does not submit
+// to. until the call that ends the pass, moved resources may only be used through the new handles and only by work
+// submitted on this context after the active command buffer. the old handles are destroyed by that call, as are
+// resources being moved that were destroyed during the pass
+extern VKM_FN VkResult vkm_context_defragment(vkm_context, vkm_context_defragInfo, vkm_context_defragStats*);
+// copies the resolved scopes of the most recently completed frame in the order they were begun, lock free and callable
+// from any thread while the context is alive. if pResults is null only *pCount is written.
+// returns VK_INCOMPLETE if *pCount was too small, VK_NOT_READY if no frame has been resolved yet and
+// VK_ERROR_FEATURE_NOT_PRESENT if the context was created without timestamps
+extern VKM_FN VkResult vkm_context_getTimestampResults(vkm_context, uint64_t* pFrame, uint32_t* pCount,
+													   vkm_context_timestampResult* pResults);
+// aggregates the samples currently in the phase's ring, must not be called concurrently with other calls on the context.
+// returns VK_ERROR_FEATURE_NOT_PRESENT if vkm was built without VKM_INSTRUMENTATION
+extern VKM_FN VkResult vkm_context_getPhaseStats(vkm_context, vkm_context_phase, vkm_context_phaseStats*);
+// copies up to *pCount of the most recent samples in nanoseconds oldest first, if pSamples is null only *pCount is written.
+// returns VK_ERROR_FEATURE_NOT_PRESENT if vkm was built without VKM_INSTRUMENTATION
+extern VKM_FN VkResult vkm_context_getPhaseSamples(vkm_context, vkm_context_phase, uint32_t* pCount, uint64_t* pSamples);
+// the most of each object used by any single frame so far, including the current one,
+// numFences is the most fences ever acquired at once across the whole device.
+// must not be called concurrently with recording on the context
+extern VKM_FN void vkm_context_getHighWaterMarks(vkm_context, vkm_context_prewarmInfo*);
+// submits every command buffer ended since the last flush in submission order then presents,
+// a no-op if nothing is pending
+extern VKM_FN void vkm_context_flush(vkm_context);
+// calls vkm_context_flush
 extern VKM_FN void vkm_context_end(vkm_context);
 extern VKM_FN void vkm_context_wait(vkm_context);
 
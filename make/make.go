@@ -43,7 +43,8 @@ import (
 )
 
 type EnableFeatures struct {
-	PIC bool // If true, will add -fPIC on linux
+	PIC             bool // If true, will add -fPIC on linux
+	Instrumentation bool // If true, will compile in vkm_context phase timing, otherwise vkm_context_getPhase* return VK_ERROR_FEATURE_NOT_PRESENT
 }
 type BuildOptions struct {
 	Build  toolchain.Build
@@ -88,6 +89,9 @@ func installVKM(c Config) error {
 		} else {
 			buildID += "-nofpic"
 		}
+		if c.BuildOptions.Enable.Instrumentation {
+			buildID += "-instrumented"
+		}
 		version = buildID
 		if c.ForceStatic {
 			version += "-static"
@@ -213,6 +217,10 @@ func installVKM(c Config) error {
 				buildFlags.CFlags = append(buildFlags.CFlags, "-fPIC")
 				buildFlags.CXXFlags = append(buildFlags.CXXFlags, "-fPIC")
 			}
+			if c.BuildOptions.Enable.Instrumentation {
+				buildFlags.CFlags = append(buildFlags.CFlags, "-DVKM_INSTRUMENTATION=1")
+				buildFlags.CXXFlags = append(buildFlags.CXXFlags, "-DVKM_INSTRUMENTATION=1")
+			}
 			buildOptions.BuildFlags = buildFlags
 
 			ldFlags, err := cgodep.Resolve(c.Target, cgodep.ResolveLDFlags, deps...)
@@ -262,6 +270,12 @@ func installVKM(c Config) error {
 			if err != nil {
 				panic(err)
 			}
+			if c.BuildOptions.Enable.Instrumentation {
+				_, err = fmt.Fprintf(fConfig, "#define VKM_INSTRUMENTATION 1\n")
+				if err != nil {
+					panic(err)
+				}
+			}
 		}
 	}
 
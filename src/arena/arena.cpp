@@ -0,0 +1,204 @@
+/*
+Copyright 2026 The goARRG Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "vkm/vkm.h"  // IWYU pragma: associated
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+#include "vkm/std/algorithm.hpp"
+#include "vkm/std/defer.hpp"
+#include "vkm/std/stdlib.hpp"
+#include "vkm/std/string.hpp"
+#include "vkm/std/utility.hpp"
+
+#include "vkm.hpp"
+#include "vklog.hpp"
+#include "reflect_const.hpp"
+#include "device/device.hpp"
+#include "device/vma/vma.hpp"
+#include "arena/arena.hpp"
+
+extern "C" {
+VKM_FN void vkm_createBufferArena(vkm_device instanceHandle, vkm_string name, vkm_bufferArenaCreateInfo info,
+								  vkm_bufferArena* arenaHandle) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	auto* a = new (::std::nothrow)::vkm::vk::bufferArena();
+
+	a->instance = instance;
+	if (name.len != 0 && name.ptr != nullptr) {
+		vkm::std::stringbuilder builder;
+		builder << name << "_bufferArena";
+		a->name = builder.str();
+	} else {
+		a->name = "bufferArena";
+	}
+
+	{
+		const VkBufferCreateInfo bufferInfo = {
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = info.size,
+			.usage = info.usage,
+		};
+		VmaAllocationCreateInfo allocCreateInfo = {};
+		if (info.hostVisible) {
+			allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+			allocCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+			allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		} else {
+			allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+			allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		}
+		allocCreateInfo.memoryTypeBits = instance->vma.noBARMemoryTypeBits;
+
+		VkResult ret = vmaCreateBuffer(instance->vma.allocator, &bufferInfo, &allocCreateInfo, &a->vkBuffer,
+									   &a->vmaAllocation, nullptr);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create arena buffer: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+
+		a->ptr = nullptr;
+		if (info.hostVisible) {
+			void* ptr;
+			ret = vmaMapMemory(instance->vma.allocator, a->vmaAllocation, &ptr);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to map arena buffer: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+			a->ptr = static_cast<uint8_t*>(ptr);
+		}
+
+		vkm::std::debugRun([=]() {
+			vkm::vk::debugLabel(instance->vkDevice, a->vkBuffer, a->name.cStr());
+
+			vkm::std::stringbuilder builder;
+			builder << a->name << "_allocation";
+			vmaSetAllocationName(instance->vma.allocator, a->vmaAllocation, builder.cStr());
+		});
+	}
+	{
+		VmaVirtualBlockCreateInfo blockInfo = {};
+		blockInfo.size = info.size;
+
+		const VkResult ret = vmaCreateVirtualBlock(&blockInfo, &a->vmaVirtualBlock);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create virtual block: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+	}
+
+	*arenaHandle = a->handle();
+}
+VKM_FN void vkm_destroyBufferArena(vkm_bufferArena arenaHandle) {
+	auto* a = ::vkm::vk::bufferArena::fromHandle(arenaHandle);
+	auto* instance = a->instance;
+
+	vkm::std::debugRun([=]() {
+		if (a->sliceNames.size() > 0) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "%s destroyed with %zu live slices, including %s",
+					   a->name.cStr(), a->sliceNames.size(), a->sliceNames[0].name.cStr());
+		}
+	});
+	if (vmaIsVirtualBlockEmpty(a->vmaVirtualBlock) != VK_TRUE) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "%s destroyed with live slices", a->name.cStr());
+	}
+	vmaDestroyVirtualBlock(a->vmaVirtualBlock);
+
+	if (a->ptr != nullptr) {
+		vmaUnmapMemory(instance->vma.allocator, a->vmaAllocation);
+	}
+	vmaDestroyBuffer(instance->vma.allocator, a->vkBuffer, a->vmaAllocation);
+	delete a;
+}
+VKM_FN VkResult vkm_bufferArena_allocate(vkm_bufferArena arenaHandle, vkm_string name, VkDeviceSize size,
+										 VkDeviceSize alignment, vkm_bufferSlice* slice) {
+	auto* a = ::vkm::vk::bufferArena::fromHandle(arenaHandle);
+	a->mutex.lock();
+	DEFER([&] { a->mutex.unlock(); });
+
+	VmaVirtualAllocationCreateInfo allocInfo = {};
+	allocInfo.size = size;
+	allocInfo.alignment = alignment;
+
+	VmaVirtualAllocation allocation;
+	VkDeviceSize offset;
+	const VkResult ret = vmaVirtualAllocate(a->vmaVirtualBlock, &allocInfo, &allocation, &offset);
+	if (ret == VK_ERROR_OUT_OF_DEVICE_MEMORY) {
+		return ret;
+	}
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to allocate from %s: %s", a->name.cStr(),
+				   vkm::vk::reflect::toString(ret).cStr());
+	}
+
+	vkm::std::debugRun([&]() {
+		vkm::std::stringbuilder builder;
+		builder << a->name << "_" << name << "_" << offset;
+		a->sliceNames.pushBack(::vkm::vk::bufferArena::sliceName{
+			.allocation = allocation,
+			.name = builder.str(),
+		});
+	});
+
+	*slice = vkm_bufferSlice{
+		.allocation = reinterpret_cast<vkm_allocation>(allocation),
+		.vkBuffer = a->vkBuffer,
+		.offset = offset,
+		.size = size,
+		.ptr = a->ptr != nullptr ? a->ptr + offset : nullptr,
+	};
+	return VK_SUCCESS;
+}
+VKM_FN void vkm_bufferArena_free(vkm_bufferArena arenaHandle, const vkm_bufferSlice* slice) {
+	auto* a = ::vkm::vk::bufferArena::fromHandle(arenaHandle);
+	a->mutex.lock();
+	DEFER([&] { a->mutex.unlock(); });
+
+	auto allocation = reinterpret_cast<VmaVirtualAllocation>(slice->allocation);
+	vkm::std::debugRun([&]() {
+		auto& names = a->sliceNames;
+		const size_t i = vkm::std::linearSearch(names.size(), [&](size_t i) -> bool { return names[i].allocation == allocation; });
+		if (i == names.size()) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Slice at offset %llu was not allocated from %s",
+					   static_cast<unsigned long long>(slice->offset), a->name.cStr());
+		}
+		vkm::std::swap(names[i], names.last());
+		names.popBack();
+	});
+	vmaVirtualFree(a->vmaVirtualBlock, allocation);
+}
+VKM_FN void vkm_bufferArena_getStats(vkm_bufferArena arenaHandle, vkm_bufferArenaStats* stats) {
+	auto* a = ::vkm::vk::bufferArena::fromHandle(arenaHandle);
+	a->mutex.lock();
+	DEFER([&] { a->mutex.unlock(); });
+
+	VmaDetailedStatistics detailed = {};
+	vmaCalculateVirtualBlockStatistics(a->vmaVirtualBlock, &detailed);
+
+	const VkDeviceSize freeBytes = detailed.statistics.blockBytes - detailed.statistics.allocationBytes;
+	const VkDeviceSize largestFreeRange = detailed.unusedRangeCount > 0 ? detailed.unusedRangeSizeMax : 0;
+	*stats = vkm_bufferArenaStats{
+		.sliceCount = detailed.statistics.allocationCount,
+		.usedBytes = detailed.statistics.allocationBytes,
+		.freeBytes = freeBytes,
+		.freeRangeCount = detailed.unusedRangeCount,
+		.largestFreeRange = largestFreeRange,
+		.fragmentation = freeBytes > 0 ? 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(freeBytes) : 0.0f,
+	};
+}
+}
@@ -0,0 +1,58 @@
+/*
+Copyright 2026 The goARRG Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#ifndef __cplusplus
+#error C++ only header
+#endif
+
+#include <stdint.h>
+
+#include "vkm/std/string.hpp"
+#include "vkm/std/vector.hpp"
+#include "vkm/std/thread.hpp"
+
+#include "vkm/vkm.h"
+#include "vkm.hpp"
+#include "device/device.hpp"
+#include "device/vma/vma.hpp"
+
+namespace vkm::vk {
+// every public function locks mutex as VMA virtual blocks are not thread safe
+struct bufferArena {
+	device::instance* instance;
+	vkm::std::string<char> name;
+	vkm::std::mutex mutex;
+
+	VkBuffer vkBuffer;
+	VmaAllocation vmaAllocation;
+	uint8_t* ptr;
+	VmaVirtualBlock vmaVirtualBlock;
+
+	// debug builds only, names of the live slices so leaks can be reported by name
+	struct sliceName {
+		VmaVirtualAllocation allocation;
+		vkm::std::string<char> name;
+	};
+	vkm::std::vector<sliceName> sliceNames;
+
+	[[nodiscard]] vkm_bufferArena handle() noexcept { return reinterpret_cast<vkm_bufferArena>(this); }
+	[[nodiscard]] static bufferArena* fromHandle(vkm_bufferArena handle) noexcept {
+		return reinterpret_cast<bufferArena*>(handle);
+	}
+};
+}  // namespace vkm::vk
@@ -19,24 +19,115 @@ limitations under the License.
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include <new>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "vkm/std/stdlib.hpp"
 #include "vkm/std/string.hpp"
+#include "vkm/std/utility.hpp"
+#include "vkm/std/vector.hpp"
 
 #include "vkm.hpp"
 #include "vklog.hpp"
 #include "reflect_const.hpp"
 #include "device/device.hpp"
 #include "device/vma/vma.hpp"
+#include "uploader/uploader.hpp"
+
+// below this memcpy is as fast and keeps the data in cache
+static constexpr size_t streamingThreshold = 64 * 1024;
+
+// copies with non temporal stores so write combined memory gets full lines without reading the cache back
+static void streamingCopy(uint8_t* dst, const uint8_t* src, size_t sz) noexcept {
+#if defined(__SSE2__)
+	const size_t head = vkm::std::min(sz, static_cast<size_t>((16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15));
+	memcpy(dst, src, head);
+	dst += head;
+	src += head;
+	sz -= head;
+
+	for (; sz >= 64; sz -= 64, dst += 64, src += 64) {
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+		const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+		const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst), a);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), c);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), d);
+	}
+	// non temporal stores are weakly ordered, make them visible before anything that follows
+	_mm_sfence();
+#endif
+	memcpy(dst, src, sz);
+}
+
+// creates count buffers, each bound to its own allocation from allocateMemoryBatch.
+// failed buffers are left as VK_NULL_HANDLE with a null allocation
+static void createBufferBatch(vkm::vk::device::instance* instance, uint32_t count, const VkBufferCreateInfo* infos,
+							  const VmaAllocationCreateInfo& allocCreateInfo, bool movable, VkBuffer* buffers,
+							  VmaAllocation* allocations, VkResult* results) noexcept {
+	vkm::std::vector<VkMemoryRequirements> requirements(count);
+	for (uint32_t i = 0; i < count; i++) {
+		const VkDeviceBufferMemoryRequirements info = {
+			.sType = VK_STRUCTURE_TYPE_DEVICE_BUFFER_MEMORY_REQUIREMENTS,
+			.pCreateInfo = &infos[i],
+		};
+		VkMemoryRequirements2 bufferRequirements = {.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+		VK_PROC_DEVICE(instance, vkGetDeviceBufferMemoryRequirements)(instance->vkDevice, &info, &bufferRequirements);
+		requirements[i] = bufferRequirements.memoryRequirements;
+	}
+	vkm::vk::device::allocateMemoryBatch(instance, allocCreateInfo, movable, count, requirements.get(), allocations,
+										 results);
+
+	for (uint32_t i = 0; i < count; i++) {
+		buffers[i] = VK_NULL_HANDLE;
+		if (results[i] != VK_SUCCESS) {
+			continue;
+		}
+		results[i] = VK_PROC_DEVICE(instance, vkCreateBuffer)(instance->vkDevice, &infos[i], nullptr, &buffers[i]);
+		if (results[i] == VK_SUCCESS) {
+			results[i] = vmaBindBufferMemory(instance->vma.allocator, allocations[i], buffers[i]);
+			if (results[i] != VK_SUCCESS) {
+				VK_PROC_DEVICE(instance, vkDestroyBuffer)(instance->vkDevice, buffers[i], nullptr);
+				buffers[i] = VK_NULL_HANDLE;
+			}
+		}
+		if (results[i] != VK_SUCCESS) {
+			vmaFreeMemory(instance->vma.allocator, allocations[i]);
+			allocations[i] = nullptr;
+		}
+	}
+}
 
 VKM_FN void vkm_createHostBuffer(vkm_device instanceHandle, vkm_string name, VkBufferCreateInfo info, vkm_hostBuffer* b) {
+	vkm_createHostBuffer2(instanceHandle, name, info, VKM_HOST_ACCESS_CACHED, b);
+}
+VKM_FN void vkm_createHostBuffer2(vkm_device instanceHandle, vkm_string name, VkBufferCreateInfo info, vkm_hostAccess access,
+								  vkm_hostBuffer* b) {
 	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
 
 	{
 		VmaAllocationCreateInfo allocCreateInfo = {};
 		allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
 		allocCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-		allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		switch (access) {
+			case VKM_HOST_ACCESS_CACHED:
+				allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+				break;
+			case VKM_HOST_ACCESS_CACHED_NON_COHERENT:
+				allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+				break;
+			case VKM_HOST_ACCESS_WRITE_COMBINED:
+				// sequential write access without random access makes VMA prefer uncached memory when there is some
+				allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+				break;
+			default:
+				vkm::fatal(vkm::std::sourceLocation::current(), "Unknown host access %d", static_cast<int>(access));
+		}
 		allocCreateInfo.memoryTypeBits = instance->vma.noBARMemoryTypeBits;
 
 		VkResult ret = vmaCreateBuffer(instance->vma.allocator, &info, &allocCreateInfo, &b->vkBuffer,
@@ -66,20 +157,131 @@ VKM_FN void vkm_destroyHostBuffer(vkm_device instanceHandle, vkm_hostBuffer b) {
 	vmaUnmapMemory(instance->vma.allocator, reinterpret_cast<VmaAllocation>(b.allocation));
 	vmaDestroyBuffer(instance->vma.allocator, b.vkBuffer, reinterpret_cast<VmaAllocation>(b.allocation));
 }
-VKM_FN void vkm_hostBuffer_write(vkm_device, vkm_hostBuffer buffer, size_t offset, size_t sz, void* data) {
-	memcpy(static_cast<void*>(static_cast<uint8_t*>(buffer.ptr) + offset), data, sz);
+VKM_FN void vkm_createHostBuffers(vkm_device instanceHandle, uint32_t count, const vkm_string* names,
+								  const VkBufferCreateInfo* infos, vkm_hostBuffer* buffers, VkResult* results) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+
+	VmaAllocationCreateInfo allocCreateInfo = {};
+	allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+	allocCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+	allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	allocCreateInfo.memoryTypeBits = instance->vma.noBARMemoryTypeBits;
+
+	vkm::std::vector<VkBuffer> vkBuffers(count);
+	vkm::std::vector<VmaAllocation> allocations(count);
+	createBufferBatch(instance, count, infos, allocCreateInfo, false, vkBuffers.get(), allocations.get(), results);
+
+	for (uint32_t i = 0; i < count; i++) {
+		buffers[i] = vkm_hostBuffer{
+			.allocation = reinterpret_cast<vkm_allocation>(allocations[i]),
+			.vkBuffer = vkBuffers[i],
+			.ptr = nullptr,
+		};
+		if (results[i] != VK_SUCCESS) {
+			continue;
+		}
+		results[i] = vmaMapMemory(instance->vma.allocator, allocations[i], &buffers[i].ptr);
+		if (results[i] != VK_SUCCESS) {
+			vmaDestroyBuffer(instance->vma.allocator, vkBuffers[i], allocations[i]);
+			buffers[i] = {};
+			continue;
+		}
+		vkm::std::debugRun([&]() {
+			vkm::std::stringbuilder builder;
+			if (names != nullptr) {
+				builder.write(names[i]);
+			}
+			builder.write("_hostBuffer");
+			vkm::vk::debugLabel(instance->vkDevice, buffers[i].vkBuffer, builder.cStr());
+
+			builder.write("_allocation");
+			vmaSetAllocationName(instance->vma.allocator, allocations[i], builder.cStr());
+		});
+	}
+}
+VKM_FN void vkm_destroyHostBuffers(vkm_device instanceHandle, uint32_t count, const vkm_hostBuffer* buffers) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	if (count == 0) {
+		return;
+	}
+
+	vkm::std::vector<VmaAllocation> allocations(count);
+	for (uint32_t i = 0; i < count; i++) {
+		allocations[i] = reinterpret_cast<VmaAllocation>(buffers[i].allocation);
+		if (allocations[i] != nullptr) {
+			vmaUnmapMemory(instance->vma.allocator, allocations[i]);
+			VK_PROC_DEVICE(instance, vkDestroyBuffer)(instance->vkDevice, buffers[i].vkBuffer, nullptr);
+		}
+	}
+	vmaFreeMemoryPages(instance->vma.allocator, count, allocations.get());
+}
+VKM_FN void vkm_hostBuffer_write(vkm_device instanceHandle, vkm_hostBuffer buffer, size_t offset, size_t sz, void* data) {
+	auto* dst = static_cast<uint8_t*>(buffer.ptr) + offset;
+	if (sz >= streamingThreshold) {
+		auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+		VkMemoryPropertyFlags flags;
+		vmaGetAllocationMemoryProperties(instance->vma.allocator, reinterpret_cast<VmaAllocation>(buffer.allocation), &flags);
+		if ((flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) == 0) {
+			streamingCopy(dst, static_cast<const uint8_t*>(data), sz);
+			return;
+		}
+	}
+	memcpy(static_cast<void*>(dst), data, sz);
 }
 VKM_FN void vkm_hostBuffer_read(vkm_device, vkm_hostBuffer buffer, size_t offset, size_t sz, void* data) {
 	memcpy(data, static_cast<void*>(static_cast<uint8_t*>(buffer.ptr) + offset), sz);
 }
+VKM_FN void vkm_hostBuffer_flush(vkm_device instanceHandle, vkm_hostBuffer buffer, VkDeviceSize offset, VkDeviceSize sz) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	const VkResult ret =
+		vmaFlushAllocation(instance->vma.allocator, reinterpret_cast<VmaAllocation>(buffer.allocation), offset, sz);
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to flush buffer: %s", vkm::vk::reflect::toString(ret).cStr());
+	}
+}
+VKM_FN void vkm_hostBuffer_invalidate(vkm_device instanceHandle, vkm_hostBuffer buffer, VkDeviceSize offset, VkDeviceSize sz) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	const VkResult ret =
+		vmaInvalidateAllocation(instance->vma.allocator, reinterpret_cast<VmaAllocation>(buffer.allocation), offset, sz);
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to invalidate buffer: %s",
+				   vkm::vk::reflect::toString(ret).cStr());
+	}
+}
 VKM_FN void vkm_createDeviceBuffer(vkm_device instanceHandle, vkm_string name, VkBufferCreateInfo info, vkm_deviceBuffer* b) {
+	vkm_createDeviceBuffer2(instanceHandle, name, info, 0.5f, b);
+}
+VKM_FN void vkm_createDeviceBuffer2(vkm_device instanceHandle, vkm_string name, VkBufferCreateInfo info, float priority,
+									vkm_deviceBuffer* b) {
 	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	if (priority < 0.0f || priority > 1.0f) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Buffer priority %f is outside of [0, 1]",
+				   static_cast<double>(priority));
+	}
 
 	{
+		auto* movable = ::vkm::vk::device::movableResource::fromBufferInfo(info);
+
 		VmaAllocationCreateInfo allocCreateInfo = {};
 		allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 		allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 		allocCreateInfo.memoryTypeBits = instance->vma.noBARMemoryTypeBits;
+		allocCreateInfo.pUserData = movable;
+		allocCreateInfo.priority = priority;
+		// priority belongs to the VkDeviceMemory, so a block shared with default priority resources would ignore it
+		if (instance->optionalFeatures.hasEXTMemoryPriority && priority != 0.5f) {
+			allocCreateInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+		}
+		{
+			uint32_t memoryTypeIndex;
+			const VkResult ret = vmaFindMemoryTypeIndexForBufferInfo(instance->vma.allocator, &info, &allocCreateInfo,
+																	 &memoryTypeIndex);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to find memory type for buffer: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+			allocCreateInfo.pool = ::vkm::vk::device::movablePool(instance, memoryTypeIndex);
+		}
 
 		const VkResult ret = vmaCreateBuffer(instance->vma.allocator, &info, &allocCreateInfo, &b->vkBuffer,
 											 reinterpret_cast<VmaAllocation*>(&b->allocation), nullptr);
@@ -87,6 +289,7 @@ VKM_FN void vkm_createDeviceBuffer(vkm_device instanceHandle, vkm_string name, V
 			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create buffer: %s",
 					   vkm::vk::reflect::toString(ret).cStr());
 		}
+		movable->vkBuffer = b->vkBuffer;
 	}
 	vkm::std::debugRun([=]() {
 		vkm::std::stringbuilder builder;
@@ -99,6 +302,146 @@ VKM_FN void vkm_createDeviceBuffer(vkm_device instanceHandle, vkm_string name, V
 }
 VKM_FN void vkm_destroyDeviceBuffer(vkm_device instanceHandle, vkm_deviceBuffer b) {
 	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	if (::vkm::vk::device::deferDefragDestroy(instance, reinterpret_cast<VmaAllocation>(b.allocation))) {
+		return;
+	}
+
+	delete ::vkm::vk::device::movableResource::fromAllocation(instance->vma.allocator,
+															  reinterpret_cast<VmaAllocation>(b.allocation));
+	vmaDestroyBuffer(instance->vma.allocator, b.vkBuffer, reinterpret_cast<VmaAllocation>(b.allocation));
+}
+VKM_FN void vkm_createDeviceBuffers(vkm_device instanceHandle, uint32_t count, const vkm_string* names,
+									const VkBufferCreateInfo* infos, vkm_deviceBuffer* buffers, VkResult* results) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
 
+	VmaAllocationCreateInfo allocCreateInfo = {};
+	allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+	allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	allocCreateInfo.memoryTypeBits = instance->vma.noBARMemoryTypeBits;
+
+	vkm::std::vector<VkBuffer> vkBuffers(count);
+	vkm::std::vector<VmaAllocation> allocations(count);
+	createBufferBatch(instance, count, infos, allocCreateInfo, true, vkBuffers.get(), allocations.get(), results);
+
+	for (uint32_t i = 0; i < count; i++) {
+		buffers[i] = vkm_deviceBuffer{
+			.allocation = reinterpret_cast<vkm_allocation>(allocations[i]),
+			.vkBuffer = vkBuffers[i],
+		};
+		if (results[i] != VK_SUCCESS) {
+			continue;
+		}
+		auto* movable = ::vkm::vk::device::movableResource::fromBufferInfo(infos[i]);
+		movable->vkBuffer = vkBuffers[i];
+		vmaSetAllocationUserData(instance->vma.allocator, allocations[i], movable);
+
+		vkm::std::debugRun([&]() {
+			vkm::std::stringbuilder builder;
+			if (names != nullptr) {
+				builder.write(names[i]);
+			}
+			builder.write("_deviceBuffer");
+			vkm::vk::debugLabel(instance->vkDevice, buffers[i].vkBuffer, builder.cStr());
+
+			builder.write("_allocation");
+			vmaSetAllocationName(instance->vma.allocator, allocations[i], builder.cStr());
+		});
+	}
+}
+VKM_FN void vkm_destroyDeviceBuffers(vkm_device instanceHandle, uint32_t count, const vkm_deviceBuffer* buffers) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	if (count == 0) {
+		return;
+	}
+
+	vkm::std::vector<VmaAllocation> allocations(count);
+	for (uint32_t i = 0; i < count; i++) {
+		allocations[i] = reinterpret_cast<VmaAllocation>(buffers[i].allocation);
+		if (allocations[i] != nullptr && ::vkm::vk::device::deferDefragDestroy(instance, allocations[i])) {
+			allocations[i] = nullptr;
+		}
+		if (allocations[i] != nullptr) {
+			delete ::vkm::vk::device::movableResource::fromAllocation(instance->vma.allocator, allocations[i]);
+			VK_PROC_DEVICE(instance, vkDestroyBuffer)(instance->vkDevice, buffers[i].vkBuffer, nullptr);
+		}
+	}
+	vmaFreeMemoryPages(instance->vma.allocator, count, allocations.get());
+}
+VKM_FN void vkm_createBarBuffer(vkm_device instanceHandle, vkm_string name, VkBufferCreateInfo info, vkm_barBuffer* b) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	b->ptr = nullptr;
+
+	VkResult ret = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	if (instance->vma.barMemoryTypeBits != 0) {
+		VmaAllocationCreateInfo allocCreateInfo = {};
+		allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+		// fail instead of pushing the small BAR heap over budget so we can fall back
+		allocCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+		allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		allocCreateInfo.memoryTypeBits = instance->vma.barMemoryTypeBits;
+
+		ret = vmaCreateBuffer(instance->vma.allocator, &info, &allocCreateInfo, &b->vkBuffer,
+							  reinterpret_cast<VmaAllocation*>(&b->allocation), nullptr);
+		if (ret == VK_SUCCESS) {
+			ret = vmaMapMemory(instance->vma.allocator, reinterpret_cast<VmaAllocation>(b->allocation), &b->ptr);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to map buffer: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+		} else if (ret != VK_ERROR_OUT_OF_DEVICE_MEMORY && ret != VK_ERROR_FEATURE_NOT_PRESENT) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create buffer: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+	}
+	if (ret != VK_SUCCESS) {
+		info.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		VmaAllocationCreateInfo allocCreateInfo = {};
+		allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+		allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		allocCreateInfo.memoryTypeBits = instance->vma.noBARMemoryTypeBits;
+
+		ret = vmaCreateBuffer(instance->vma.allocator, &info, &allocCreateInfo, &b->vkBuffer,
+							  reinterpret_cast<VmaAllocation*>(&b->allocation), nullptr);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create buffer: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+	}
+	vkm::std::debugRun([=]() {
+		vkm::std::stringbuilder builder;
+		builder.write(name).write(b->ptr != nullptr ? "_barBuffer" : "_barBuffer_staged");
+		vkm::vk::debugLabel(instance->vkDevice, b->vkBuffer, builder.cStr());
+
+		builder.write("_allocation");
+		vmaSetAllocationName(instance->vma.allocator, reinterpret_cast<VmaAllocation>(b->allocation), builder.cStr());
+	});
+}
+VKM_FN void vkm_destroyBarBuffer(vkm_device instanceHandle, vkm_barBuffer b) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+
+	if (b.ptr != nullptr) {
+		vmaUnmapMemory(instance->vma.allocator, reinterpret_cast<VmaAllocation>(b.allocation));
+	}
 	vmaDestroyBuffer(instance->vma.allocator, b.vkBuffer, reinterpret_cast<VmaAllocation>(b.allocation));
 }
+VKM_FN vkm_completionToken vkm_barBuffer_write(vkm_uploader uploaderHandle, vkm_barBuffer buffer, VkDeviceSize offset,
+											   VkDeviceSize size, const void* data) {
+	if (buffer.ptr == nullptr) {
+		return vkm_uploader_uploadBuffer(uploaderHandle, buffer.vkBuffer, offset, size, data);
+	}
+
+	auto* u = ::vkm::vk::uploader::fromHandle(uploaderHandle);
+	memcpy(static_cast<void*>(static_cast<uint8_t*>(buffer.ptr) + offset), data, size);
+	// BAR memory is not guaranteed to be coherent, no-op if it is
+	const VkResult ret =
+		vmaFlushAllocation(u->instance->vma.allocator, reinterpret_cast<VmaAllocation>(buffer.allocation), offset, size);
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to flush buffer: %s", vkm::vk::reflect::toString(ret).cStr());
+	}
+	// every value is >= 0 so the token is already reached
+	return vkm_completionToken{
+		.vkSemaphore = u->semaphore.vkSemaphore,
+		.value = 0,
+	};
+}
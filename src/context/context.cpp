@@ -16,13 +16,16 @@ limitations under the License.
 
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include <new>
+#include <algorithm>
 
+#include "vkm/std/algorithm.hpp"
 #include "vkm/std/string.hpp"
 #include "vkm/std/utility.hpp"
 #include "vkm/std/stdlib.hpp"
-#include "vkm/std/array.hpp"
 #include "vkm/std/vector.hpp"
+#include "vkm/std/defer.hpp"
 
 #include "vkm/vkm.h"
 #include "vkm.hpp"
@@ -33,6 +36,537 @@ limitations under the License.
 #include "context/context.hpp"
 #include "swapchain/swapchain.hpp"
 
+namespace vkm::vk {
+static void runDestroyerThread(void* data) noexcept {
+	auto* ctx = static_cast<context*>(data);
+	auto& t = ctx->destroyerThread;
+
+	t.mutex.lock();
+	for (;;) {
+		while (t.pendingBatches.size() == 0 && !t.stop) {
+			t.wake.wait(t.mutex);
+		}
+		// on stop every batch already handed over still runs before exiting
+		if (t.pendingBatches.size() == 0) {
+			break;
+		}
+		vkm::std::vector<vkm_destroyer> batch = t.pendingBatches.dequeueFront();
+		t.busy = true;
+		t.mutex.unlock();
+
+		for (auto& d : batch) {
+			d.fn(d.data);
+		}
+		batch.resize(0);
+
+		t.mutex.lock();
+		t.freeBatches.pushBack(vkm::std::move(batch));
+		t.busy = false;
+		if (t.pendingBatches.size() == 0) {
+			t.idle.broadcast();
+		}
+	}
+	t.mutex.unlock();
+}
+void context::retireDestroyers(vkm::std::vector<vkm_destroyer>& destroyers) noexcept {
+	auto& t = this->destroyerThread;
+
+	t.mutex.lock();
+	t.pendingBatches.pushBack(vkm::std::move(destroyers));
+	if (t.freeBatches.size() > 0) {
+		destroyers = t.freeBatches.dequeueBack();
+	}
+	t.wake.signal();
+	t.mutex.unlock();
+}
+void context::flushDestroyers() noexcept {
+	auto& t = this->destroyerThread;
+	if (!t.enabled) {
+		return;
+	}
+
+	t.mutex.lock();
+	while (t.pendingBatches.size() > 0 || t.busy) {
+		t.idle.wait(t.mutex);
+	}
+	t.mutex.unlock();
+}
+
+// allocates count command buffers from pool in one call and appends them to commandBuffers
+static void allocateCommandBuffers(device::instance* instance, VkCommandPool pool, VkCommandBufferLevel level, uint32_t count,
+								   vkm::std::vector<VkCommandBuffer>& commandBuffers) noexcept {
+	if (count == 0) {
+		return;
+	}
+	const size_t offset = commandBuffers.size();
+	commandBuffers.resize(offset + count);
+	const VkCommandBufferAllocateInfo allocateInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = pool,
+		.level = level,
+		.commandBufferCount = count,
+	};
+	const VkResult ret = VK_PROC_DEVICE(instance, vkAllocateCommandBuffers)(instance->vkDevice, &allocateInfo,
+																			 commandBuffers.get() + offset);
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create command buffer: %s",
+				   vkm::vk::reflect::toString(ret).cStr());
+	}
+}
+// must hold ctx->readbacks.mutex, fatals in debug builds if the ticket's buffer was released or handed out again
+static void checkReadbackTicket(context* ctx, const vkm_readbackTicket* ticket) noexcept {
+	vkm::std::debugRun([&]() {
+		const auto& buffers = ctx->readbacks.buffers;
+		if (ticket->slot >= buffers.size() || !buffers[ticket->slot].inUse ||
+			buffers[ticket->slot].generation != ticket->generation) {
+			vkm::fatal(vkm::std::sourceLocation::current(),
+					   "Readback ticket for slot %u is stale or was already released", ticket->slot);
+		}
+	});
+}
+static bool acquiredFromPool(const context::frame::threadPool& pool, VkCommandBuffer cb, bool primaryOnly) noexcept {
+	for (size_t i = 0; i < pool.acquiredPrimaryCommandBuffers; i++) {
+		if (pool.primaryCommandBuffers[i] == cb) {
+			return true;
+		}
+	}
+	if (primaryOnly) {
+		return false;
+	}
+	for (size_t i = 0; i < pool.acquiredSecondaryCommandBuffers; i++) {
+		if (pool.secondaryCommandBuffers[i] == cb) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t context::recordSubmit(frame& frame, size_t numCommandBuffers, const VkCommandBuffer* commandBuffers,
+							   const vkm_context_commandBufferEndInfo& info) noexcept {
+	frame.pendingSubmits.pushBack(vkm::vk::context::frame::pendingSubmit{
+		.pNext = info.queueSubmitInfo.pNext,
+		.flags = info.queueSubmitInfo.flags,
+		.waitSemaphoreOffset = static_cast<uint32_t>(frame.pendingSubmitWaitSemaphores.size()),
+		.commandBufferOffset = static_cast<uint32_t>(frame.pendingSubmitCommandBuffers.size()),
+		.numCommandBuffers = static_cast<uint32_t>(numCommandBuffers),
+		.signalSemaphoreOffset = static_cast<uint32_t>(frame.pendingSubmitSignalSemaphores.size()),
+	});
+	auto& submit = frame.pendingSubmits.last();
+
+	for (size_t i = 0; i < numCommandBuffers; i++) {
+		frame.pendingSubmitCommandBuffers.pushBack(VkCommandBufferSubmitInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+			.pNext = info.commandBufferSubmitInfo.pNext,
+			.commandBuffer = commandBuffers[i],
+		});
+	}
+	{
+		frame.pendingSubmitWaitSemaphores.pushBack(frame.pendingWaitSemaphores.size(), frame.pendingWaitSemaphores.get());
+		frame.pendingSubmitWaitSemaphores.pushBack(info.queueSubmitInfo.numWaitSemaphores, info.queueSubmitInfo.pWaitSemaphores);
+		submit.numWaitSemaphores = frame.pendingSubmitWaitSemaphores.size() - submit.waitSemaphoreOffset;
+	}
+	{
+		for (size_t i = 0; i < info.numPrsentInfos; i++) {
+			auto present = info.pPresentInfos[i];
+			auto* swapchain = vkm::vk::swapchain::fromHandle(present.swapchain);
+			if (present.stage == 0) {
+				frame.pendingSubmitSignalSemaphores.pushBack(VkSemaphoreSubmitInfo{
+					.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+					.semaphore = swapchain->semaphore(),
+					.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+				});
+			} else {
+				frame.pendingSubmitSignalSemaphores.pushBack(VkSemaphoreSubmitInfo{
+					.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+					.semaphore = swapchain->semaphore(),
+					.stageMask = present.stage,
+				});
+			}
+		}
+		frame.pendingSubmitSignalSemaphores.pushBack(VkSemaphoreSubmitInfo{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = this->semaphore.vkSemaphore,
+			.value = ++this->semaphore.pendingValue,
+			.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+		});
+		frame.pendingSubmitSignalSemaphores.pushBack(info.queueSubmitInfo.numSignalSemaphores, info.queueSubmitInfo.pSignalSemaphores);
+		submit.numSignalSemaphores = frame.pendingSubmitSignalSemaphores.size() - submit.signalSemaphoreOffset;
+	}
+	frame.pendingPresents.pushBack(info.numPrsentInfos, info.pPresentInfos);
+	frame.pendingWaitSemaphores.resize(0);
+
+	// acquire semaphores are only waited on by this submit so they can be reused once it completes
+	for (VkSemaphore s : frame.pendingBinarySemaphores) {
+		this->retiringBinarySemaphores.pushBack(vkm::std::pair{this->semaphore.pendingValue, s});
+	}
+	frame.pendingBinarySemaphores.resize(0);
+	return this->semaphore.pendingValue;
+}
+void context::retire(uint64_t completedValue) noexcept {
+	{
+		size_t n = 0;
+		for (auto& r : this->retiringDestroyers) {
+			if (r.first <= completedValue) {
+				this->retiredDestroyers.pushBack(r.second);
+			} else {
+				this->retiringDestroyers[n++] = r;
+			}
+		}
+		this->retiringDestroyers.resize(n);
+
+		if (this->destroyerThread.enabled) {
+			if (this->retiredDestroyers.size() > 0) {
+				this->retireDestroyers(this->retiredDestroyers);
+			}
+		} else {
+			for (auto& d : this->retiredDestroyers) {
+				d.fn(d.data);
+			}
+			this->retiredDestroyers.resize(0);
+		}
+	}
+	{
+		size_t n = 0;
+		for (auto& r : this->retiringBinarySemaphores) {
+			if (r.first <= completedValue) {
+				this->instance->syncObjectManager.releaseBinarySemaphore(r.second);
+			} else {
+				this->retiringBinarySemaphores[n++] = r;
+			}
+		}
+		this->retiringBinarySemaphores.resize(n);
+	}
+	{
+		size_t n = 0;
+		for (auto& r : this->retiringScratchBuffers) {
+			if (r.first <= completedValue) {
+				vmaUnmapMemory(this->instance->vma.allocator, r.second.second);
+				vmaDestroyBuffer(this->instance->vma.allocator, r.second.first, r.second.second);
+			} else {
+				this->retiringScratchBuffers[n++] = r;
+			}
+		}
+		this->retiringScratchBuffers.resize(n);
+	}
+}
+void context::beginTimestampScope(frame& frame, VkCommandBuffer cb, vkm_string name) noexcept {
+	if (this->timestamps.numQueries == 0) {
+		return;
+	}
+
+	vkm::vk::context::frame::timestampScope scope = {
+		.result = {
+			.depth = static_cast<uint32_t>(frame.timestamps.openScopes.size()),
+		},
+		.cb = cb,
+		.query = UINT32_MAX,
+	};
+	{
+		const size_t len = vkm::std::min(name.len, sizeof(scope.result.name) - 1);
+		if (len > 0) {
+			memcpy(static_cast<char*>(scope.result.name), name.ptr, len);
+		}
+		scope.result.name[len] = 0;
+	}
+	if (frame.timestamps.usedQueries + 2 <= this->timestamps.numQueries) {
+		scope.query = frame.timestamps.usedQueries;
+		frame.timestamps.usedQueries += 2;
+		VK_PROC_DEVICE(this->instance, vkCmdWriteTimestamp2)(
+			cb, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frame.timestamps.vkQueryPool, scope.query);
+	}
+	frame.timestamps.scopes.pushBack(scope);
+	frame.timestamps.openScopes.pushBack(frame.timestamps.scopes.size() - 1);
+}
+void context::endTimestampScope(frame& frame, VkCommandBuffer cb) noexcept {
+	if (this->timestamps.numQueries == 0) {
+		return;
+	}
+	if (frame.timestamps.openScopes.size() == 0) {
+		vkm::fatal("No open timestamp scope to end");
+	}
+
+	const auto& scope = frame.timestamps.scopes[frame.timestamps.openScopes.dequeueBack()];
+	if (scope.cb != cb) {
+		vkm::fatal("Timestamp scope must be ended in the command buffer it was begun in");
+	}
+	if (scope.query != UINT32_MAX) {
+		VK_PROC_DEVICE(this->instance, vkCmdWriteTimestamp2)(
+			cb, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frame.timestamps.vkQueryPool, scope.query + 1);
+	}
+}
+void context::resolveTimestamps(frame& frame) noexcept {
+	if (this->timestamps.numQueries == 0) {
+		return;
+	}
+
+	if (frame.timestamps.usedQueries > 0) {
+		auto& results = this->timestamps.queryResults;
+		results.resize(frame.timestamps.usedQueries);
+		const VkResult ret = VK_PROC_DEVICE(this->instance, vkGetQueryPoolResults)(
+			this->instance->vkDevice, frame.timestamps.vkQueryPool, 0, frame.timestamps.usedQueries,
+			results.size() * sizeof(uint64_t), results.get(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (ret == VK_SUCCESS) {
+			const uint64_t mask = this->timestamps.validMask;
+			uint64_t origin = UINT64_MAX;
+			for (const auto& scope : frame.timestamps.scopes) {
+				if (scope.query != UINT32_MAX) {
+					origin = vkm::std::min(origin, results[scope.query] & mask);
+				}
+			}
+
+			// seqlock write, readers retry if sequence is odd or changed while they were copying
+			const uint64_t sequence = this->timestamps.sequence.load(vkm::std::memoryOrder::relaxed);
+			this->timestamps.sequence.store(sequence + 1, vkm::std::memoryOrder::relaxed);
+			vkm::std::atomicThreadFence(vkm::std::memoryOrder::release);
+
+			uint32_t n = 0;
+			for (const auto& scope : frame.timestamps.scopes) {
+				if (scope.query == UINT32_MAX) {
+					continue;
+				}
+				const uint64_t begin = results[scope.query] & mask;
+				const uint64_t end = results[scope.query + 1] & mask;
+
+				auto& r = this->timestamps.published[n++];
+				r = scope.result;
+				r.start = static_cast<uint64_t>(static_cast<double>((begin - origin) & mask) * this->timestamps.period);
+				r.duration = static_cast<uint64_t>(static_cast<double>((end - begin) & mask) * this->timestamps.period);
+			}
+			this->timestamps.publishedCount.store(n, vkm::std::memoryOrder::relaxed);
+			this->timestamps.publishedFrame.store(frame.timestamps.frameNumber, vkm::std::memoryOrder::relaxed);
+			this->timestamps.sequence.store(sequence + 2, vkm::std::memoryOrder::release);
+		} else if (ret != VK_NOT_READY) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to get timestamp results: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+		VK_PROC_DEVICE(this->instance, vkResetQueryPool)(
+			this->instance->vkDevice, frame.timestamps.vkQueryPool, 0, frame.timestamps.usedQueries);
+	}
+
+	frame.timestamps.usedQueries = 0;
+	frame.timestamps.scopes.resize(0);
+	frame.timestamps.openScopes.resize(0);
+	frame.timestamps.frameNumber = this->timestamps.frameNumber++;
+}
+VkResult context::endDefragmentPass() noexcept {
+	auto& pass = this->instance->defragPass;
+	pass.mutex.lock();
+	DEFER([&] { pass.mutex.unlock(); });
+	// resources destroyed during the pass lose both handles and VMA frees their memory instead of moving it
+	for (uint32_t i = 0; i < this->defrag.pass.moveCount; i++) {
+		auto& move = this->defrag.pass.pMoves[i];
+		if (!pass.destroyed.contains(move.srcAllocation)) {
+			continue;
+		}
+		// only the batch creates leave it null, and only until they return
+		auto* movable =
+			::vkm::vk::device::movableResource::fromAllocation(this->instance->vma.allocator, move.srcAllocation);
+		if (movable == nullptr) {
+			continue;
+		}
+		if (movable->type == VK_OBJECT_TYPE_BUFFER) {
+			VK_PROC_DEVICE(this->instance, vkDestroyBuffer)(this->instance->vkDevice, movable->vkBuffer, nullptr);
+		} else {
+			VK_PROC_DEVICE(this->instance, vkDestroyImage)(this->instance->vkDevice, movable->vkImage, nullptr);
+		}
+		delete movable;
+		move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_DESTROY;
+	}
+	for (const auto& move : this->defrag.moves) {
+		if (move.objectType == VK_OBJECT_TYPE_BUFFER) {
+			VK_PROC_DEVICE(this->instance, vkDestroyBuffer)(this->instance->vkDevice, move.oldBuffer, nullptr);
+		} else {
+			VK_PROC_DEVICE(this->instance, vkDestroyImage)(this->instance->vkDevice, move.oldImage, nullptr);
+		}
+	}
+	this->defrag.moves.resize(0);
+	this->defrag.passActive = false;
+
+	const VkResult ret =
+		vmaEndDefragmentationPass(this->instance->vma.allocator, this->defrag.vmaContext, &this->defrag.pass);
+	if (ret != VK_SUCCESS && ret != VK_INCOMPLETE) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to end defragmentation pass: %s",
+				   vkm::vk::reflect::toString(ret).cStr());
+	}
+	pass.moving.resize(0);
+	pass.destroyed.resize(0);
+	return ret;
+}
+bool context::beginDefragmentPool(const vkm_context_defragInfo& info) noexcept {
+	VmaDefragmentationInfo defragInfo = {};
+	{
+		auto& vma = this->instance->vma;
+		vma.movablePoolsMutex.lock();
+		DEFER([&] { vma.movablePoolsMutex.unlock(); });
+		if (this->defrag.poolIndex >= vma.movablePools.size()) {
+			return false;
+		}
+		defragInfo.pool = vma.movablePools[this->defrag.poolIndex].second;
+	}
+	defragInfo.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+	defragInfo.maxBytesPerPass = info.maxBytesPerPass;
+	defragInfo.maxAllocationsPerPass = info.maxMovesPerPass;
+
+	const VkResult ret = vmaBeginDefragmentation(this->instance->vma.allocator, &defragInfo, &this->defrag.vmaContext);
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to begin defragmentation: %s",
+				   vkm::vk::reflect::toString(ret).cStr());
+	}
+	return true;
+}
+void context::endDefragmentPool() noexcept {
+	VmaDefragmentationStats vmaStats = {};
+	vmaEndDefragmentation(this->instance->vma.allocator, this->defrag.vmaContext, &vmaStats);
+	this->defrag.vmaContext = nullptr;
+	this->defrag.poolIndex++;
+
+	this->defrag.stats.bytesMoved += vmaStats.bytesMoved;
+	this->defrag.stats.bytesFreed += vmaStats.bytesFreed;
+	this->defrag.stats.allocationsMoved += vmaStats.allocationsMoved;
+	this->defrag.stats.deviceMemoryBlocksFreed += vmaStats.deviceMemoryBlocksFreed;
+}
+void context::endDefragment(vkm_context_defragStats* stats) noexcept {
+	if (this->defrag.vmaContext != nullptr) {
+		this->endDefragmentPool();
+	}
+	this->instance->defragmenting.store(false);
+	::vkm::vk::device::destroyRetiredTimelines(this->instance);
+
+	if (stats != nullptr) {
+		*stats = this->defrag.stats;
+	}
+}
+void context::updateHighWaterMarks(const frame& frame) noexcept {
+	auto& marks = this->highWaterMarks;
+	marks.numCommandBuffers = vkm::std::max(marks.numCommandBuffers, static_cast<uint32_t>(frame.acquiredCommandBuffers));
+	marks.numBinarySemaphores = vkm::std::max(marks.numBinarySemaphores, static_cast<uint32_t>(frame.acquiredBinarySemaphores));
+	for (const auto& pool : frame.threadPools) {
+		marks.numThreadPrimaryCommandBuffers = vkm::std::max(marks.numThreadPrimaryCommandBuffers,
+															 static_cast<uint32_t>(pool.acquiredPrimaryCommandBuffers));
+		marks.numThreadSecondaryCommandBuffers = vkm::std::max(marks.numThreadSecondaryCommandBuffers,
+															   static_cast<uint32_t>(pool.acquiredSecondaryCommandBuffers));
+	}
+}
+void context::beginFrame(vkm_string name) noexcept {
+	auto& frame = this->frames[this->frameID];
+
+	vkm::vk::device::evaluateMemoryWatermarks(this->instance);
+	this->updateHighWaterMarks(frame);
+	frame.acquiredBinarySemaphores = 0;
+
+	this->resolveTimestamps(frame);
+	{
+		VKM_CONTEXT_PHASE(this, VKM_CONTEXT_PHASE_DESTROYERS);
+		this->retire(vkm_semaphore_timeline_getValue(this->instance->handle(), this->semaphore.vkSemaphore));
+		if (this->destroyerThread.enabled) {
+			if (frame.pendingDestroyers.size() > 0) {
+				this->retireDestroyers(frame.pendingDestroyers);
+			}
+		} else {
+			for (auto& d : frame.pendingDestroyers) {
+				d.fn(d.data);
+			}
+			frame.pendingDestroyers.resize(0);
+		}
+		{
+			for (VkSemaphore s : frame.pendingBinarySemaphores) {
+				this->instance->syncObjectManager.releaseBinarySemaphore(s);
+			}
+			frame.pendingBinarySemaphores.resize(0);
+		}
+		{
+			for (auto& b : frame.pendingScratchBuffers) {
+				vmaUnmapMemory(this->instance->vma.allocator, b.second);
+				vmaDestroyBuffer(this->instance->vma.allocator, b.first, b.second);
+			}
+			frame.pendingScratchBuffers.resize(0);
+			frame.scratchBlockIndex = 0;
+			frame.scratchBlockOffset = 0;
+		}
+	}
+	{
+		VKM_CONTEXT_PHASE(this, VKM_CONTEXT_PHASE_COMMAND_POOL_RESET);
+		{
+			{
+				const VkResult ret = VK_PROC_DEVICE(this->instance, vkResetCommandPool)(this->instance->vkDevice, frame.vkCommandPool, 0);
+				if (ret != VK_SUCCESS) {
+					vkm::fatal(vkm::std::sourceLocation::current(), "Failed to reset command pool: %s",
+							   vkm::vk::reflect::toString(ret).cStr());
+				}
+			}
+			if (frame.acquiredCommandBuffers != frame.submittedCommandBuffers) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Acquired %zu command buffers but submitted %zu",
+						   frame.acquiredCommandBuffers, frame.submittedCommandBuffers);
+			}
+			frame.acquiredCommandBuffers = frame.submittedCommandBuffers = 0;
+		}
+		for (auto& pool : frame.threadPools) {
+			const VkResult ret = VK_PROC_DEVICE(this->instance, vkResetCommandPool)(this->instance->vkDevice, pool.vkCommandPool, 0);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to reset command pool: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+			pool.acquiredPrimaryCommandBuffers = pool.acquiredSecondaryCommandBuffers = 0;
+		}
+	}
+
+	vkm::std::debugRun([&]() {
+		if (name.len != 0 && name.ptr != nullptr) {
+			vkm::std::stringbuilder builder;
+			builder << frame.name << "_" << name;
+			vkm::vk::debugLabelBegin(this->vkQueue, builder.cStr());
+		} else {
+			vkm::vk::debugLabelBegin(this->vkQueue, frame.name.cStr());
+		}
+	});
+}
+void context::flush() noexcept {
+	auto& frame = this->frames[this->frameID];
+	if (frame.pendingSubmits.size() == 0) {
+		return;
+	}
+
+	this->submitInfos.resize(0);
+	for (const auto& submit : frame.pendingSubmits) {
+		this->submitInfos.pushBack(VkSubmitInfo2{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+			.pNext = submit.pNext,
+			.flags = submit.flags,
+
+			.waitSemaphoreInfoCount = submit.numWaitSemaphores,
+			.pWaitSemaphoreInfos = frame.pendingSubmitWaitSemaphores.get() + submit.waitSemaphoreOffset,
+
+			.commandBufferInfoCount = submit.numCommandBuffers,
+			.pCommandBufferInfos = frame.pendingSubmitCommandBuffers.get() + submit.commandBufferOffset,
+
+			.signalSemaphoreInfoCount = submit.numSignalSemaphores,
+			.pSignalSemaphoreInfos = frame.pendingSubmitSignalSemaphores.get() + submit.signalSemaphoreOffset,
+		});
+	}
+	{
+		VKM_CONTEXT_PHASE(this, VKM_CONTEXT_PHASE_SUBMIT);
+		const VkResult ret = VK_PROC_DEVICE(this->instance, vkQueueSubmit2)(
+			this->vkQueue, this->submitInfos.size(), this->submitInfos.get(), VK_NULL_HANDLE);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to submit %s: %s", frame.name.cStr(),
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+		this->semaphore.submitted.value.store(this->semaphore.pendingValue, vkm::std::memoryOrder::release);
+	}
+	frame.pendingSubmits.resize(0);
+	frame.pendingSubmitCommandBuffers.resize(0);
+	frame.pendingSubmitWaitSemaphores.resize(0);
+	frame.pendingSubmitSignalSemaphores.resize(0);
+
+	for (auto present : frame.pendingPresents) {
+		auto* swapchain = vkm::vk::swapchain::fromHandle(present.swapchain);
+		VKM_CONTEXT_PHASE(this, VKM_CONTEXT_PHASE_PRESENT);
+		*present.pResult = swapchain->present(this->vkQueue);
+	}
+	frame.pendingPresents.resize(0);
+}
+}  // namespace vkm::vk
+
 VKM_FN void vkm_createContext(vkm_device instanceHandle, vkm_string name, vkm_contextCreateInfo info, vkm_context* ctxHandle) {
 	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
 	auto* ctx = new (::std::nothrow)::vkm::vk::context();
@@ -48,11 +582,32 @@ VKM_FN void vkm_createContext(vkm_device instanceHandle, vkm_string name, vkm_co
 		ctx->name = builder.str();
 	}
 	ctx->queueFamily = info.queueFamily;
+	ctx->deferSubmit = info.deferSubmit;
+	ctx->destroyerThread.enabled = info.backgroundDestroyers;
+	ctx->destroyerThread.stop = ctx->destroyerThread.busy = false;
+	if (ctx->destroyerThread.enabled) {
+		ctx->destroyerThread.thread.start(::vkm::vk::runDestroyerThread, ctx);
+	}
 	VK_PROC_DEVICE(instance, vkGetDeviceQueue)(instance->vkDevice, info.queueFamily, info.queueIndex, &ctx->vkQueue);
 
+	{
+		VkPhysicalDeviceProperties properties = {};
+		VK_PROC(vkGetPhysicalDeviceProperties)(instance->vkPhysicalDevice, &properties);
+
+		ctx->timestamps.period = properties.limits.timestampPeriod;
+		ctx->scratchBlockInfo.blockSize = info.scratchBlockCreateInfo.blockSize;
+		ctx->scratchBlockInfo.usage = info.scratchBlockCreateInfo.usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		ctx->scratchBlockInfo.defaultAlignment = vkm::std::max(
+			vkm::std::max(properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment),
+			vkm::std::max(properties.limits.minTexelBufferOffsetAlignment, properties.limits.optimalBufferCopyOffsetAlignment));
+	}
+
 	{
 		ctx->semaphore.pendingValue = 0;
 		vkm_createTimelineSemaphore(instanceHandle, ctx->name.vkm_string(), ctx->semaphore.pendingValue, &ctx->semaphore.vkSemaphore);
+		ctx->semaphore.submitted.vkSemaphore = ctx->semaphore.vkSemaphore;
+		ctx->semaphore.submitted.value.store(0);
+		::vkm::vk::device::registerTimeline(instance, &ctx->semaphore.submitted);
 	}
 	{
 		uint32_t memTypeIndex;
@@ -94,6 +649,27 @@ VKM_FN void vkm_createContext(vkm_device instanceHandle, vkm_string name, vkm_co
 			vmaSetPoolName(instance->vma.allocator, ctx->vmaPool, builder.cStr());
 		});
 	}
+	{
+		ctx->timestamps.numQueries = 2 * info.maxTimestampScopes;
+		ctx->timestamps.frameNumber = 0;
+		if (ctx->timestamps.numQueries > 0) {
+			if (!instance->optionalFeatures.hasHostQueryReset) {
+				vkm::fatal("Context timestamps require the hostQueryReset feature");
+			}
+
+			uint32_t numQueueFamilies = 0;
+			VK_PROC(vkGetPhysicalDeviceQueueFamilyProperties)(instance->vkPhysicalDevice, &numQueueFamilies, nullptr);
+			vkm::std::vector<VkQueueFamilyProperties> queueFamilies(numQueueFamilies);
+			VK_PROC(vkGetPhysicalDeviceQueueFamilyProperties)(instance->vkPhysicalDevice, &numQueueFamilies, queueFamilies.get());
+
+			const uint32_t validBits = queueFamilies[info.queueFamily].timestampValidBits;
+			if (validBits == 0) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Queue family %u does not support timestamps", info.queueFamily);
+			}
+			ctx->timestamps.validMask = validBits >= 64 ? UINT64_MAX : ((uint64_t(1) << validBits) - 1);
+			ctx->timestamps.published.resize(info.maxTimestampScopes);
+		}
+	}
 	{
 		ctx->frames.resize(vkm::std::max(1u, info.maxPendingFrames));
 		for (size_t i = 0; i < ctx->frames.size(); i++) {
@@ -103,6 +679,9 @@ VKM_FN void vkm_createContext(vkm_device instanceHandle, vkm_string name, vkm_co
 				builder << ctx->name << "_frame_" << i;
 				frame.name = builder.str();
 				frame.pendingSemaphoreValue = frame.acquiredCommandBuffers = frame.submittedCommandBuffers = 0;
+				frame.acquiredBinarySemaphores = 0;
+				frame.scratchBlockIndex = 0;
+				frame.scratchBlockOffset = 0;
 			}
 			{
 				const VkCommandPoolCreateInfo poolInfo = {
@@ -122,16 +701,87 @@ VKM_FN void vkm_createContext(vkm_device instanceHandle, vkm_string name, vkm_co
 					builder << ctx->name << "_cmdPool_" << i;
 					vkm::vk::debugLabel(instance->vkDevice, frame.vkCommandPool, builder.cStr());
 				});
+				::vkm::vk::allocateCommandBuffers(instance, frame.vkCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+												  info.prewarm.numCommandBuffers, frame.commandBuffers);
+			}
+			frame.timestamps.vkQueryPool = VK_NULL_HANDLE;
+			frame.timestamps.frameNumber = 0;
+			frame.timestamps.usedQueries = 0;
+			if (ctx->timestamps.numQueries > 0) {
+				const VkQueryPoolCreateInfo queryPoolInfo = {
+					.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+					.queryType = VK_QUERY_TYPE_TIMESTAMP,
+					.queryCount = ctx->timestamps.numQueries,
+				};
+				const VkResult ret = VK_PROC_DEVICE(instance, vkCreateQueryPool)(
+					instance->vkDevice, &queryPoolInfo, nullptr, &frame.timestamps.vkQueryPool);
+				if (ret != VK_SUCCESS) {
+					vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create query pool: %s",
+							   vkm::vk::reflect::toString(ret).cStr());
+				}
+				VK_PROC_DEVICE(instance, vkResetQueryPool)(instance->vkDevice, frame.timestamps.vkQueryPool, 0, ctx->timestamps.numQueries);
+				vkm::std::debugRun([&]() {
+					vkm::std::stringbuilder builder;
+					builder << ctx->name << "_timestampPool_" << i;
+					vkm::vk::debugLabel(instance->vkDevice, frame.timestamps.vkQueryPool, builder.cStr());
+				});
+			}
+			frame.threadPools.resize(info.numThreadPools);
+			for (size_t t = 0; t < frame.threadPools.size(); t++) {
+				auto& pool = frame.threadPools[t];
+				pool.activeCommandBuffers = pool.acquiredPrimaryCommandBuffers = pool.acquiredSecondaryCommandBuffers = 0;
+
+				const VkCommandPoolCreateInfo poolInfo = {
+					.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+					.pNext = info.commandPoolCreateInfo.pNext,
+					.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | info.commandPoolCreateInfo.flags,
+					.queueFamilyIndex = info.queueFamily,
+				};
+				const VkResult ret = VK_PROC_DEVICE(instance, vkCreateCommandPool)(
+					instance->vkDevice, &poolInfo, nullptr, &pool.vkCommandPool);
+				if (ret != VK_SUCCESS) {
+					vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create commandpool: %s",
+							   vkm::vk::reflect::toString(ret).cStr());
+				}
+				vkm::std::debugRun([&]() {
+					vkm::std::stringbuilder builder;
+					builder << ctx->name << "_cmdPool_" << i << "_thread_" << t;
+					vkm::vk::debugLabel(instance->vkDevice, pool.vkCommandPool, builder.cStr());
+				});
+				::vkm::vk::allocateCommandBuffers(instance, pool.vkCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+												  info.prewarm.numThreadPrimaryCommandBuffers, pool.primaryCommandBuffers);
+				::vkm::vk::allocateCommandBuffers(instance, pool.vkCommandPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+												  info.prewarm.numThreadSecondaryCommandBuffers, pool.secondaryCommandBuffers);
 			}
 		}
 	}
 
+	ctx->highWaterMarks = {};
+	instance->syncObjectManager.prewarm(info.prewarm.numBinarySemaphores * static_cast<uint32_t>(ctx->frames.size()),
+										info.prewarm.numFences);
+
 	*ctxHandle = ctx->handle();
 }
 VKM_FN void vkm_destroyContext(vkm_context ctxHandle) {
 	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	ctx->flush();
 	vkm_semaphore_timeline_wait(ctx->instance->handle(), ctx->semaphore.vkSemaphore, ctx->semaphore.pendingValue);
-	VK_PROC_DEVICE(ctx->instance, vkDestroySemaphore)(ctx->instance->vkDevice, ctx->semaphore.vkSemaphore, nullptr);
+	::vkm::vk::device::unregisterTimeline(ctx->instance, &ctx->semaphore.submitted);
+	ctx->retire(ctx->semaphore.pendingValue);
+	if (ctx->defrag.vmaContext != nullptr) {
+		if (ctx->defrag.passActive) {
+			static_cast<void>(ctx->endDefragmentPass());
+		}
+		ctx->endDefragment(nullptr);
+	}
+	if (ctx->destroyerThread.enabled) {
+		// batches already handed over belong to older frames so they must run first
+		ctx->destroyerThread.mutex.lock();
+		ctx->destroyerThread.stop = true;
+		ctx->destroyerThread.wake.signal();
+		ctx->destroyerThread.mutex.unlock();
+		ctx->destroyerThread.thread.join();
+	}
 	for (auto& frame : ctx->frames) {
 		for (auto& d : frame.pendingDestroyers) {
 			d.fn(d.data);
@@ -143,9 +793,25 @@ VKM_FN void vkm_destroyContext(vkm_context ctxHandle) {
 			vmaUnmapMemory(ctx->instance->vma.allocator, b.second);
 			vmaDestroyBuffer(ctx->instance->vma.allocator, b.first, b.second);
 		}
+		for (auto& b : frame.scratchBlocks) {
+			vmaDestroyBuffer(ctx->instance->vma.allocator, b.vkBuffer, b.vmaAllocation);
+		}
 		VK_PROC_DEVICE(ctx->instance, vkFreeCommandBuffers)(
 			ctx->instance->vkDevice, frame.vkCommandPool, frame.commandBuffers.size(), frame.commandBuffers.get());
 		VK_PROC_DEVICE(ctx->instance, vkDestroyCommandPool)(ctx->instance->vkDevice, frame.vkCommandPool, nullptr);
+		VK_PROC_DEVICE(ctx->instance, vkDestroyQueryPool)(ctx->instance->vkDevice, frame.timestamps.vkQueryPool, nullptr);
+		for (auto& pool : frame.threadPools) {
+			VK_PROC_DEVICE(ctx->instance, vkFreeCommandBuffers)(
+				ctx->instance->vkDevice, pool.vkCommandPool, pool.primaryCommandBuffers.size(), pool.primaryCommandBuffers.get());
+			VK_PROC_DEVICE(ctx->instance, vkFreeCommandBuffers)(ctx->instance->vkDevice, pool.vkCommandPool,
+																 pool.secondaryCommandBuffers.size(),
+																 pool.secondaryCommandBuffers.get());
+			VK_PROC_DEVICE(ctx->instance, vkDestroyCommandPool)(ctx->instance->vkDevice, pool.vkCommandPool, nullptr);
+		}
+	}
+	for (auto& b : ctx->readbacks.buffers) {
+		vmaUnmapMemory(ctx->instance->vma.allocator, b.vmaAllocation);
+		vmaDestroyBuffer(ctx->instance->vma.allocator, b.vkBuffer, b.vmaAllocation);
 	}
 	vmaDestroyPool(ctx->instance->vma.allocator, ctx->vmaPool);
 	delete ctx;
@@ -166,50 +832,75 @@ VKM_FN void vkm_context_begin(vkm_context ctxHandle, vkm_string name) {
 	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
 	auto& frame = ctx->frames[ctx->frameID];
 
-	vkm_semaphore_timeline_wait(ctx->instance->handle(), ctx->semaphore.vkSemaphore, frame.pendingSemaphoreValue);
 	{
-		for (auto& d : frame.pendingDestroyers) {
-			d.fn(d.data);
-		}
-		frame.pendingDestroyers.resize(0);
+		VKM_CONTEXT_PHASE(ctx, VKM_CONTEXT_PHASE_BEGIN_WAIT);
+		vkm_semaphore_timeline_wait(ctx->instance->handle(), ctx->semaphore.vkSemaphore, frame.pendingSemaphoreValue);
 	}
-	{
-		for (VkSemaphore s : frame.pendingBinarySemaphores) {
-			ctx->instance->syncObjectManager.releaseBinarySemaphore(s);
-		}
-		frame.pendingBinarySemaphores.resize(0);
+	ctx->beginFrame(name);
+}
+VKM_FN VkResult vkm_context_tryBegin(vkm_context ctxHandle, vkm_string name) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	auto& frame = ctx->frames[ctx->frameID];
+
+	uint64_t value = 0;
+	const VkResult ret = VK_PROC_DEVICE(ctx->instance, vkGetSemaphoreCounterValue)(
+		ctx->instance->vkDevice, ctx->semaphore.vkSemaphore, &value);
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed getting semaphore value: %s",
+				   vkm::vk::reflect::toString(ret).cStr());
 	}
-	{
-		for (auto& b : frame.pendingScratchBuffers) {
-			vmaUnmapMemory(ctx->instance->vma.allocator, b.second);
-			vmaDestroyBuffer(ctx->instance->vma.allocator, b.first, b.second);
-		}
-		frame.pendingScratchBuffers.resize(0);
+	if (value < frame.pendingSemaphoreValue) {
+		return VK_NOT_READY;
 	}
+	ctx->beginFrame(name);
+	return VK_SUCCESS;
+}
+VKM_FN VkResult vkm_context_beginTimeout(vkm_context ctxHandle, vkm_string name, uint64_t timeout) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	auto& frame = ctx->frames[ctx->frameID];
+
+	VkResult ret;
 	{
-		{
-			const VkResult ret = VK_PROC_DEVICE(ctx->instance, vkResetCommandPool)(ctx->instance->vkDevice, frame.vkCommandPool, 0);
-			if (ret != VK_SUCCESS) {
-				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to reset command pool: %s",
-						   vkm::vk::reflect::toString(ret).cStr());
-			}
-		}
-		if (frame.acquiredCommandBuffers != frame.submittedCommandBuffers) {
-			vkm::fatal(vkm::std::sourceLocation::current(), "Acquired %zu command buffers but submitted %zu",
-					   frame.acquiredCommandBuffers, frame.submittedCommandBuffers);
-		}
-		frame.acquiredCommandBuffers = frame.submittedCommandBuffers = 0;
+		VKM_CONTEXT_PHASE(ctx, VKM_CONTEXT_PHASE_BEGIN_WAIT);
+		ret = vkm_semaphore_timeline_waitMany(ctx->instance->handle(), 1, &ctx->semaphore.vkSemaphore,
+											  &frame.pendingSemaphoreValue, 0, timeout);
+	}
+	if (ret == VK_TIMEOUT) {
+		return VK_TIMEOUT;
+	}
+	ctx->beginFrame(name);
+	return VK_SUCCESS;
+}
+VKM_FN void vkm_context_flushDestroyers(vkm_context ctxHandle) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	ctx->flushDestroyers();
+}
+VKM_FN void vkm_context_queueTokenDestroyer(vkm_context ctxHandle, vkm_completionToken token, vkm_destroyer destroyer) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	if (token.vkSemaphore != ctx->semaphore.vkSemaphore) {
+		vkm::fatal("Completion token was not created by this context");
+	}
+	ctx->retiringDestroyers.pushBack(vkm::std::pair{token.value, destroyer});
+}
+VKM_FN void vkm_context_releaseScratchHostBuffer(vkm_context ctxHandle, const vkm_hostBuffer* b, vkm_completionToken token) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	auto& frame = ctx->frames[ctx->frameID];
+	if (token.vkSemaphore != ctx->semaphore.vkSemaphore) {
+		vkm::fatal("Completion token was not created by this context");
 	}
 
-	vkm::std::debugRun([&]() {
-		if (name.len != 0 && name.ptr != nullptr) {
-			vkm::std::stringbuilder builder;
-			builder << frame.name << "_" << name;
-			vkm::vk::debugLabelBegin(ctx->vkQueue, builder.cStr());
-		} else {
-			vkm::vk::debugLabelBegin(ctx->vkQueue, frame.name.cStr());
-		}
-	});
+	const size_t i = vkm::std::linearSearch(
+		frame.pendingScratchBuffers.size(), [&](size_t i) -> bool { return frame.pendingScratchBuffers[i].first == b->vkBuffer; });
+	if (i == frame.pendingScratchBuffers.size()) {
+		vkm::fatal("Scratch host buffer was not created during the current frame of this context");
+	}
+	ctx->retiringScratchBuffers.pushBack(vkm::std::pair{token.value, frame.pendingScratchBuffers[i]});
+	frame.pendingScratchBuffers[i] = frame.pendingScratchBuffers.last();
+	frame.pendingScratchBuffers.popBack();
+}
+VKM_FN void vkm_context_retire(vkm_context ctxHandle) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	ctx->retire(vkm_semaphore_timeline_getValue(ctx->instance->handle(), ctx->semaphore.vkSemaphore));
 }
 VKM_FN void vkm_context_queueDestroyer(vkm_context ctxHandle, vkm_destroyer destroyer) {
 	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
@@ -249,6 +940,80 @@ VKM_FN void vkm_context_createScratchHostBuffer(vkm_context ctxHandle, vkm_strin
 		vmaSetAllocationName(instance->vma.allocator, reinterpret_cast<VmaAllocation>(b->allocation), builder.cStr());
 	});
 }
+VKM_FN void vkm_context_allocateScratchHostBuffer(vkm_context ctxHandle, VkDeviceSize size, VkDeviceSize alignment,
+												   vkm_hostBufferRange* r) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	auto& frame = ctx->frames[ctx->frameID];
+	auto* instance = ctx->instance;
+
+	if (ctx->scratchBlockInfo.blockSize == 0) {
+		vkm::fatal("Cannot allocate scratch host buffer range from a context created without a scratch block size");
+	}
+	if (alignment == 0) {
+		alignment = ctx->scratchBlockInfo.defaultAlignment;
+	}
+
+	while (frame.scratchBlockIndex < frame.scratchBlocks.size()) {
+		auto& block = frame.scratchBlocks[frame.scratchBlockIndex];
+		const VkDeviceSize offset = ((frame.scratchBlockOffset + alignment - 1) / alignment) * alignment;
+		if (offset + size <= block.size) {
+			frame.scratchBlockOffset = offset + size;
+			*r = vkm_hostBufferRange{
+				.vkBuffer = block.vkBuffer,
+				.offset = offset,
+				.size = size,
+				.ptr = block.ptr + offset,
+			};
+			return;
+		}
+		frame.scratchBlockIndex += 1;
+		frame.scratchBlockOffset = 0;
+	}
+
+	vkm::vk::context::frame::scratchBlock block = {
+		.size = vkm::std::max(ctx->scratchBlockInfo.blockSize, size),
+	};
+	{
+		const VkBufferCreateInfo bufferCreateInfo = {
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = block.size,
+			.usage = ctx->scratchBlockInfo.usage,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		};
+		const VmaAllocationCreateInfo allocCreateInfo = {
+			.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+			.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+			.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			.memoryTypeBits = instance->vma.noBARMemoryTypeBits,
+		};
+		VmaAllocationInfo allocInfo = {};
+		const VkResult ret = vmaCreateBuffer(
+			instance->vma.allocator, &bufferCreateInfo, &allocCreateInfo, &block.vkBuffer, &block.vmaAllocation, &allocInfo);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create scratch block: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+		block.ptr = static_cast<uint8_t*>(allocInfo.pMappedData);
+	}
+	vkm::std::debugRun([&]() {
+		vkm::std::stringbuilder builder;
+		builder << frame.name << "_scratchBlock_" << frame.scratchBlocks.size();
+		vkm::vk::debugLabel(instance->vkDevice, block.vkBuffer, builder.cStr());
+
+		builder.write("_allocation");
+		vmaSetAllocationName(instance->vma.allocator, block.vmaAllocation, builder.cStr());
+	});
+
+	frame.scratchBlocks.pushBack(block);
+	frame.scratchBlockIndex = frame.scratchBlocks.size() - 1;
+	frame.scratchBlockOffset = size;
+	*r = vkm_hostBufferRange{
+		.vkBuffer = block.vkBuffer,
+		.offset = 0,
+		.size = size,
+		.ptr = block.ptr,
+	};
+}
 VKM_FN void vkm_context_acquireSwapchain(vkm_context ctxHandle, size_t count, vkm_swapchain_acquireInfo* infos) {
 	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
 	auto& frame = ctx->frames[ctx->frameID];
@@ -261,6 +1026,7 @@ VKM_FN void vkm_context_acquireSwapchain(vkm_context ctxHandle, size_t count, vk
 		auto* swapchain = vkm::vk::swapchain::fromHandle(info.swapchain);
 		VkSemaphore semaphore = ctx->instance->syncObjectManager.acquireBinarySemaphore();
 		{
+			frame.acquiredBinarySemaphores++;
 			frame.pendingBinarySemaphores.pushBack(semaphore);
 			frame.pendingWaitSemaphores.pushBack(VkSemaphoreSubmitInfo{
 				.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
@@ -287,28 +1053,17 @@ VKM_FN void vkm_context_beginCommandBuffer(vkm_context ctxHandle, vkm_string nam
 		vkm::fatal("Cannot begin another command buffer until after ending the current one");
 	}
 
-	if (frame.commandBuffers.size() > frame.acquiredCommandBuffers) {
-		*cb = frame.commandBuffers[frame.acquiredCommandBuffers];
-	} else {
-		const VkCommandBufferAllocateInfo layoutCmdAllocateInfo = {
-			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-			.commandPool = frame.vkCommandPool,
-			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-			.commandBufferCount = 1,
-		};
-		const VkResult ret = VK_PROC_DEVICE(ctx->instance, vkAllocateCommandBuffers)(
-			ctx->instance->vkDevice, &layoutCmdAllocateInfo, cb);
-		if (ret != VK_SUCCESS) {
-			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create command buffer: %s",
-					   vkm::vk::reflect::toString(ret).cStr());
-		}
-		frame.commandBuffers.pushBack(*cb);
+	if (frame.commandBuffers.size() <= frame.acquiredCommandBuffers) {
+		::vkm::vk::allocateCommandBuffers(ctx->instance, frame.vkCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1,
+										  frame.commandBuffers);
 	}
+	*cb = frame.commandBuffers[frame.acquiredCommandBuffers];
 	{
 		const VkCommandBufferBeginInfo beginInfo = {
 			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 			.pNext = info.pNext,
 			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | info.flags,
+			.pInheritanceInfo = info.pInheritanceInfo,
 		};
 		const VkResult ret = VK_PROC_DEVICE(ctx->instance, vkBeginCommandBuffer)(*cb, &beginInfo);
 		if (ret != VK_SUCCESS) {
@@ -325,9 +1080,19 @@ VKM_FN void vkm_context_beginCommandBuffer(vkm_context ctxHandle, vkm_string nam
 		}
 		vkm::vk::debugLabelBegin(*cb, builder.cStr());
 	});
+	if (ctx->timestamps.numQueries > 0) {
+		if (name.len != 0 && name.ptr != nullptr) {
+			ctx->beginTimestampScope(frame, *cb, name);
+		} else {
+			vkm::std::stringbuilder builder;
+			builder << "commandBuffer_" << frame.acquiredCommandBuffers;
+			auto str = builder.str();
+			ctx->beginTimestampScope(frame, *cb, str.vkm_string());
+		}
+	}
 	frame.acquiredCommandBuffers += 1;
 }
-VKM_FN void vkm_context_endCommandBuffer(vkm_context ctxHandle, vkm_context_commandBufferEndInfo info) {
+VKM_FN vkm_completionToken vkm_context_endCommandBuffer(vkm_context ctxHandle, vkm_context_commandBufferEndInfo info) {
 	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
 	auto& frame = ctx->frames[ctx->frameID];
 	VkCommandBuffer cb = frame.commandBuffers[frame.submittedCommandBuffers];
@@ -336,6 +1101,90 @@ VKM_FN void vkm_context_endCommandBuffer(vkm_context ctxHandle, vkm_context_comm
 		vkm::fatal("No active command buffer to end");
 	}
 
+	ctx->endTimestampScope(frame, cb);
+	vkm::vk::debugLabelEnd(cb);
+	{
+		const VkResult ret = VK_PROC_DEVICE(ctx->instance, vkEndCommandBuffer)(cb);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to end command buffer: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+	}
+	const uint64_t value = ctx->recordSubmit(frame, 1, &cb, info);
+	frame.submittedCommandBuffers += 1;
+
+	if (!ctx->deferSubmit) {
+		ctx->flush();
+	}
+	return vkm_completionToken{
+		.vkSemaphore = ctx->semaphore.vkSemaphore,
+		.value = value,
+	};
+}
+VKM_FN void vkm_context_beginThreadCommandBuffer(vkm_context ctxHandle, uint32_t threadIndex, vkm_string name,
+												 VkCommandBufferLevel level, vkm_context_commandBufferBeginInfo info,
+												 VkCommandBuffer* cb) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	auto& frame = ctx->frames[ctx->frameID];
+
+	if (threadIndex >= frame.threadPools.size()) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Thread index %u out of range, context has %zu thread pools",
+				   threadIndex, frame.threadPools.size());
+	}
+	auto& pool = frame.threadPools[threadIndex];
+	const bool primary = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	auto& commandBuffers = primary ? pool.primaryCommandBuffers : pool.secondaryCommandBuffers;
+	auto& acquired = primary ? pool.acquiredPrimaryCommandBuffers : pool.acquiredSecondaryCommandBuffers;
+
+	if (commandBuffers.size() <= acquired) {
+		::vkm::vk::allocateCommandBuffers(ctx->instance, pool.vkCommandPool, level, 1, commandBuffers);
+	}
+	*cb = commandBuffers[acquired];
+	{
+		const VkCommandBufferBeginInfo beginInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.pNext = info.pNext,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | info.flags,
+			.pInheritanceInfo = info.pInheritanceInfo,
+		};
+		const VkResult ret = VK_PROC_DEVICE(ctx->instance, vkBeginCommandBuffer)(*cb, &beginInfo);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to begin command buffer: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+	}
+	vkm::std::debugRun([&]() {
+		vkm::std::stringbuilder builder;
+		if (name.len != 0 && name.ptr != nullptr) {
+			builder << name;
+		} else {
+			builder << frame.name << "_thread_" << threadIndex << (primary ? "_commandBuffer_" : "_secondaryCommandBuffer_")
+					<< acquired;
+		}
+		vkm::vk::debugLabelBegin(*cb, builder.cStr());
+	});
+	acquired += 1;
+	pool.activeCommandBuffers += 1;
+}
+VKM_FN void vkm_context_endThreadCommandBuffer(vkm_context ctxHandle, uint32_t threadIndex, VkCommandBuffer cb) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	auto& frame = ctx->frames[ctx->frameID];
+
+	if (threadIndex >= frame.threadPools.size()) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Thread index %u out of range, context has %zu thread pools",
+				   threadIndex, frame.threadPools.size());
+	}
+	auto& pool = frame.threadPools[threadIndex];
+	if (pool.activeCommandBuffers == 0) {
+		vkm::fatal("No active thread command buffer to end");
+	}
+	vkm::std::debugRun([&]() {
+		if (!::vkm::vk::acquiredFromPool(pool, cb, false)) {
+			vkm::fatal(vkm::std::sourceLocation::current(),
+					   "Command buffer was not begun from the pool of thread index %u this frame", threadIndex);
+		}
+	});
+
 	vkm::vk::debugLabelEnd(cb);
 	{
 		const VkResult ret = VK_PROC_DEVICE(ctx->instance, vkEndCommandBuffer)(cb);
@@ -344,72 +1193,497 @@ VKM_FN void vkm_context_endCommandBuffer(vkm_context ctxHandle, vkm_context_comm
 					   vkm::vk::reflect::toString(ret).cStr());
 		}
 	}
+	pool.activeCommandBuffers -= 1;
+}
+VKM_FN vkm_completionToken vkm_context_submitThreadCommandBuffers(vkm_context ctxHandle, size_t count,
+																   const VkCommandBuffer* cbs,
+																   vkm_context_commandBufferEndInfo info) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	auto& frame = ctx->frames[ctx->frameID];
+
+	if (count == 0) {
+		vkm::fatal("Cannot submit zero thread command buffers");
+	}
+	if (ctx->activeCommandBufferValue == ctx->semaphore.pendingValue + 1) {
+		vkm::fatal("Cannot submit thread command buffers before the active command buffer with readbacks or defragmentation ends");
+	}
+	vkm::std::debugRun([&]() {
+		for (size_t i = 0; i < count; i++) {
+			bool found = false;
+			for (const auto& pool : frame.threadPools) {
+				if (::vkm::vk::acquiredFromPool(pool, cbs[i], true)) {
+					found = true;
+					break;
+				}
+			}
+			if (!found) {
+				vkm::fatal(vkm::std::sourceLocation::current(),
+						   "Command buffer %zu is not a primary command buffer begun from a thread pool this frame", i);
+			}
+		}
+	});
+	const uint64_t value = ctx->recordSubmit(frame, count, cbs, info);
+	if (!ctx->deferSubmit) {
+		ctx->flush();
+	}
+	return vkm_completionToken{
+		.vkSemaphore = ctx->semaphore.vkSemaphore,
+		.value = value,
+	};
+}
+VKM_FN void vkm_context_beginTimestampScope(vkm_context ctxHandle, VkCommandBuffer cb, vkm_string name) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	ctx->beginTimestampScope(ctx->frames[ctx->frameID], cb, name);
+}
+VKM_FN void vkm_context_endTimestampScope(vkm_context ctxHandle, VkCommandBuffer cb) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	ctx->endTimestampScope(ctx->frames[ctx->frameID], cb);
+}
+VKM_FN void vkm_context_readbackBuffer(vkm_context ctxHandle, VkBuffer src, VkDeviceSize offset, VkDeviceSize size,
+									   vkm_readbackTicket* ticket) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	auto* instance = ctx->instance;
+	auto& frame = ctx->frames[ctx->frameID];
+
+	if (frame.acquiredCommandBuffers == frame.submittedCommandBuffers) {
+		vkm::fatal("No active command buffer to record the readback into");
+	}
+	VkCommandBuffer cb = frame.commandBuffers[frame.submittedCommandBuffers];
+
+	uint32_t slot;
+	uint32_t generation;
 	{
-		vkm::std::array commandbuffers = {
-			VkCommandBufferSubmitInfo{
-				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
-				.pNext = info.commandBufferSubmitInfo.pNext,
-				.commandBuffer = cb,
+		ctx->readbacks.mutex.lock();
+		DEFER([&] { ctx->readbacks.mutex.unlock(); });
+		auto& buffers = ctx->readbacks.buffers;
+
+		// smallest free buffer that fits
+		slot = UINT32_MAX;
+		for (size_t i = 0; i < buffers.size(); i++) {
+			if (!buffers[i].inUse && buffers[i].size >= size && (slot == UINT32_MAX || buffers[i].size < buffers[slot].size)) {
+				slot = static_cast<uint32_t>(i);
+			}
+		}
+		if (slot == UINT32_MAX) {
+			VkDeviceSize bufferSize = 64 * 1024;
+			while (bufferSize < size) {
+				bufferSize *= 2;
+			}
+			const VkBufferCreateInfo bufferInfo = {
+				.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+				.size = bufferSize,
+				.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			};
+			VmaAllocationCreateInfo allocCreateInfo = {};
+			allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+			allocCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+			allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+			allocCreateInfo.memoryTypeBits = instance->vma.noBARMemoryTypeBits;
+
+			::vkm::vk::context::readbackBuffer b = {.size = bufferSize};
+			VkResult ret = vmaCreateBuffer(instance->vma.allocator, &bufferInfo, &allocCreateInfo, &b.vkBuffer, &b.vmaAllocation, nullptr);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create readback buffer: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+			void* ptr;
+			ret = vmaMapMemory(instance->vma.allocator, b.vmaAllocation, &ptr);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to map readback buffer: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+			b.ptr = static_cast<const uint8_t*>(ptr);
+			vkm::std::debugRun([&]() {
+				vkm::std::stringbuilder builder;
+				builder << ctx->name << "_readback_" << buffers.size();
+				vkm::vk::debugLabel(instance->vkDevice, b.vkBuffer, builder.cStr());
+
+				builder.write("_allocation");
+				vmaSetAllocationName(instance->vma.allocator, b.vmaAllocation, builder.cStr());
+			});
+
+			slot = static_cast<uint32_t>(buffers.size());
+			buffers.pushBack(b);
+		}
+		buffers[slot].inUse = true;
+		buffers[slot].generation += 1;
+		generation = buffers[slot].generation;
+
+		{
+			const VkMemoryBarrier2 barrier = {
+				.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+				.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+				.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+				.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+				.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+			};
+			const VkDependencyInfo dependencyInfo = {
+				.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+				.memoryBarrierCount = 1,
+				.pMemoryBarriers = &barrier,
+			};
+			VK_PROC_DEVICE(instance, vkCmdPipelineBarrier2)(cb, &dependencyInfo);
+		}
+		{
+			const VkBufferCopy2 region = {
+				.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
+				.srcOffset = offset,
+				.dstOffset = 0,
+				.size = size,
+			};
+			const VkCopyBufferInfo2 copyInfo = {
+				.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
+				.srcBuffer = src,
+				.dstBuffer = buffers[slot].vkBuffer,
+				.regionCount = 1,
+				.pRegions = &region,
+			};
+			VK_PROC_DEVICE(instance, vkCmdCopyBuffer2)(cb, &copyInfo);
+		}
+		{
+			// makes the copy visible to the host once the submit's semaphore has been waited on
+			const VkMemoryBarrier2 barrier = {
+				.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+				.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+				.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+				.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT,
+			};
+			const VkDependencyInfo dependencyInfo = {
+				.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+				.memoryBarrierCount = 1,
+				.pMemoryBarriers = &barrier,
+			};
+			VK_PROC_DEVICE(instance, vkCmdPipelineBarrier2)(cb, &dependencyInfo);
+		}
+	}
+
+	// the active command buffer signals the next value when it is ended
+	ctx->activeCommandBufferValue = ctx->semaphore.pendingValue + 1;
+	*ticket = vkm_readbackTicket{
+		.token =
+			vkm_completionToken{
+				.vkSemaphore = ctx->semaphore.vkSemaphore,
+				.value = ctx->semaphore.pendingValue + 1,
 			},
+		.size = size,
+		.slot = slot,
+		.generation = generation,
+	};
+}
+VKM_FN VkResult vkm_context_mapReadback(vkm_context ctxHandle, const vkm_readbackTicket* ticket, const void** ppData) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	if (vkm_completionToken_poll(ctx->instance->handle(), ticket->token) != VK_TRUE) {
+		return VK_NOT_READY;
+	}
+
+	ctx->readbacks.mutex.lock();
+	::vkm::vk::checkReadbackTicket(ctx, ticket);
+	const auto b = ctx->readbacks.buffers[ticket->slot];
+	ctx->readbacks.mutex.unlock();
+
+	// no-op on coherent memory
+	const VkResult ret = vmaInvalidateAllocation(ctx->instance->vma.allocator, b.vmaAllocation, 0, ticket->size);
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to invalidate readback buffer: %s",
+				   vkm::vk::reflect::toString(ret).cStr());
+	}
+	*ppData = b.ptr;
+	return VK_SUCCESS;
+}
+VKM_FN void vkm_context_releaseReadback(vkm_context ctxHandle, const vkm_readbackTicket* ticket) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	if (vkm_completionToken_poll(ctx->instance->handle(), ticket->token) != VK_TRUE) {
+		vkm::fatal("Cannot release a readback before its copy has completed");
+	}
+
+	ctx->readbacks.mutex.lock();
+	::vkm::vk::checkReadbackTicket(ctx, ticket);
+	ctx->readbacks.buffers[ticket->slot].inUse = false;
+	ctx->readbacks.mutex.unlock();
+}
+VKM_FN VkResult vkm_context_defragment(vkm_context ctxHandle, vkm_context_defragInfo info, vkm_context_defragStats* stats) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	auto* instance = ctx->instance;
+	auto& defrag = ctx->defrag;
+
+	if (defrag.vmaContext == nullptr) {
+		bool expected = false;
+		if (!instance->defragmenting.compareExchangeStrong(expected, true)) {
+			vkm::fatal("Another context on the device is already defragmenting");
+		}
+		defrag.poolIndex = 0;
+		defrag.stats = {};
+		defrag.passActive = false;
+		if (!ctx->beginDefragmentPool(info)) {
+			ctx->endDefragment(stats);
+			return VK_SUCCESS;
+		}
+	}
+	if (defrag.passActive) {
+		if (vkm_semaphore_timeline_getValue(instance->handle(), ctx->semaphore.vkSemaphore) < defrag.passValue) {
+			return VK_INCOMPLETE;
+		}
+		if (ctx->endDefragmentPass() == VK_SUCCESS) {
+			ctx->endDefragmentPool();
+			if (!ctx->beginDefragmentPool(info)) {
+				ctx->endDefragment(stats);
+				return VK_SUCCESS;
+			}
+		}
+	}
+
+	auto& frame = ctx->frames[ctx->frameID];
+	if (frame.acquiredCommandBuffers == frame.submittedCommandBuffers) {
+		vkm::fatal("No active command buffer to record the defragmentation pass into");
+	}
+	VkCommandBuffer cb = frame.commandBuffers[frame.submittedCommandBuffers];
+
+	{
+		// held until the moves are tracked so a resource can't be destroyed in between
+		instance->defragPass.mutex.lock();
+		DEFER([&] { instance->defragPass.mutex.unlock(); });
+		for (;;) {
+			const VkResult ret = vmaBeginDefragmentationPass(instance->vma.allocator, defrag.vmaContext, &defrag.pass);
+			if (ret == VK_INCOMPLETE) {
+				break;
+			}
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to begin defragmentation pass: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+			// nothing left to move in this pool
+			ctx->endDefragmentPool();
+			if (!ctx->beginDefragmentPool(info)) {
+				ctx->endDefragment(stats);
+				return VK_SUCCESS;
+			}
+		}
+		// every move is tracked, VMA still reads the source of those it is told to ignore when the pass ends
+		for (uint32_t i = 0; i < defrag.pass.moveCount; i++) {
+			instance->defragPass.moving.pushBack(defrag.pass.pMoves[i].srcAllocation);
+		}
+	}
+	// moved resources may be in use on any queue, the copies must not start before that work is done and the old
+	// handles are only destroyed once the active command buffer, and so that work, has completed
+	::vkm::vk::device::appendTimelineWaits(instance, &ctx->semaphore.submitted, frame.pendingWaitSemaphores);
+	{
+		const VkMemoryBarrier2 barrier = {
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+			.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
 		};
-		VkSubmitInfo2 submitInfo = {
-			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
-			.pNext = info.queueSubmitInfo.pNext,
-			.flags = info.queueSubmitInfo.flags,
+		const VkDependencyInfo dependencyInfo = {
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.memoryBarrierCount = 1,
+			.pMemoryBarriers = &barrier,
+		};
+		VK_PROC_DEVICE(instance, vkCmdPipelineBarrier2)(cb, &dependencyInfo);
+	}
+	for (uint32_t i = 0; i < defrag.pass.moveCount; i++) {
+		auto& move = defrag.pass.pMoves[i];
+		auto* movable = ::vkm::vk::device::movableResource::fromAllocation(instance->vma.allocator, move.srcAllocation);
 
-			.waitSemaphoreInfoCount = info.queueSubmitInfo.numWaitSemaphores,
-			.pWaitSemaphoreInfos = info.queueSubmitInfo.pWaitSemaphores,
+		// only resources vkm can recreate and copy are moved, the rest stay where they are
+		constexpr VkFlags transferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		static_assert(transferUsage == (VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+		if (movable == nullptr
+			|| !vkm::std::cmpBitFlagsContains(movable->type == VK_OBJECT_TYPE_BUFFER ? movable->bufferInfo.usage
+																					 : movable->imageInfo.usage,
+											  transferUsage)) {
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			continue;
+		}
 
-			.commandBufferInfoCount = commandbuffers.size(),
-			.pCommandBufferInfos = commandbuffers.get(),
+		vkm_context_defragMove m = {
+			.objectType = movable->type,
+			.allocation = reinterpret_cast<vkm_allocation>(move.srcAllocation),
 		};
-		if (frame.pendingWaitSemaphores.size() > 0) {
-			frame.pendingWaitSemaphores.pushBack(info.queueSubmitInfo.numWaitSemaphores, info.queueSubmitInfo.pWaitSemaphores);
-			submitInfo.waitSemaphoreInfoCount = frame.pendingWaitSemaphores.size();
-			submitInfo.pWaitSemaphoreInfos = frame.pendingWaitSemaphores.get();
+		if (movable->type == VK_OBJECT_TYPE_BUFFER) {
+			m.oldBuffer = movable->vkBuffer;
+			VkResult ret =
+				VK_PROC_DEVICE(instance, vkCreateBuffer)(instance->vkDevice, &movable->bufferInfo, nullptr, &m.newBuffer);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create buffer: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+			ret = vmaBindBufferMemory(instance->vma.allocator, move.dstTmpAllocation, m.newBuffer);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to bind buffer: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+
+			const VkBufferCopy2 region = {
+				.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
+				.size = movable->bufferInfo.size,
+			};
+			const VkCopyBufferInfo2 copyInfo = {
+				.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
+				.srcBuffer = m.oldBuffer,
+				.dstBuffer = m.newBuffer,
+				.regionCount = 1,
+				.pRegions = &region,
+			};
+			VK_PROC_DEVICE(instance, vkCmdCopyBuffer2)(cb, &copyInfo);
+			movable->vkBuffer = m.newBuffer;
+		} else {
+			m.oldImage = movable->vkImage;
+			VkResult ret =
+				VK_PROC_DEVICE(instance, vkCreateImage)(instance->vkDevice, &movable->imageInfo, nullptr, &m.newImage);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create image: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+			ret = vmaBindImageMemory(instance->vma.allocator, move.dstTmpAllocation, m.newImage);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to bind image: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+			movable->vkImage = m.newImage;
 		}
-		{
-			for (size_t i = 0; i < info.numPrsentInfos; i++) {
-				auto present = info.pPresentInfos[i];
-				auto* swapchain = vkm::vk::swapchain::fromHandle(present.swapchain);
-				if (present.stage == 0) {
-					frame.pendingSignalSemaphores.pushBack(VkSemaphoreSubmitInfo{
-						.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-						.semaphore = swapchain->semaphore(),
-						.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-					});
+		vkm::std::debugRun([&]() {
+			VmaAllocationInfo allocInfo;
+			vmaGetAllocationInfo(instance->vma.allocator, move.srcAllocation, &allocInfo);
+			if (allocInfo.pName != nullptr) {
+				if (m.objectType == VK_OBJECT_TYPE_BUFFER) {
+					vkm::vk::debugLabel(instance->vkDevice, m.newBuffer, "%s", allocInfo.pName);
 				} else {
-					frame.pendingSignalSemaphores.pushBack(VkSemaphoreSubmitInfo{
-						.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-						.semaphore = swapchain->semaphore(),
-						.stageMask = present.stage,
-					});
+					vkm::vk::debugLabel(instance->vkDevice, m.newImage, "%s", allocInfo.pName);
 				}
 			}
-			frame.pendingSignalSemaphores.pushBack(VkSemaphoreSubmitInfo{
-				.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-				.semaphore = ctx->semaphore.vkSemaphore,
-				.value = ++ctx->semaphore.pendingValue,
-				.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-			});
-			frame.pendingSignalSemaphores.pushBack(info.queueSubmitInfo.numSignalSemaphores, info.queueSubmitInfo.pSignalSemaphores);
-			submitInfo.signalSemaphoreInfoCount = frame.pendingSignalSemaphores.size();
-			submitInfo.pSignalSemaphoreInfos = frame.pendingSignalSemaphores.get();
+		});
+
+		info.fn(info.userdata, cb, &m);
+		defrag.moves.pushBack(m);
+	}
+	{
+		const VkMemoryBarrier2 barrier = {
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+			.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+		};
+		const VkDependencyInfo dependencyInfo = {
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.memoryBarrierCount = 1,
+			.pMemoryBarriers = &barrier,
+		};
+		VK_PROC_DEVICE(instance, vkCmdPipelineBarrier2)(cb, &dependencyInfo);
+	}
+
+	// the pass ends once the active command buffer completes
+	defrag.passActive = true;
+	defrag.passValue = ctx->activeCommandBufferValue = ctx->semaphore.pendingValue + 1;
+	return VK_INCOMPLETE;
+}
+VKM_FN VkResult vkm_context_getTimestampResults(vkm_context ctxHandle, uint64_t* pFrame, uint32_t* pCount,
+												vkm_context_timestampResult* pResults) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	auto& timestamps = ctx->timestamps;
+	if (timestamps.numQueries == 0) {
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+	}
+
+	for (;;) {
+		const uint64_t sequence = timestamps.sequence.load(vkm::std::memoryOrder::acquire);
+		if (sequence == 0) {
+			return VK_NOT_READY;
 		}
-		const VkResult ret = VK_PROC_DEVICE(ctx->instance, vkQueueSubmit2)(ctx->vkQueue, 1, &submitInfo, VK_NULL_HANDLE);
-		if (ret != VK_SUCCESS) {
-			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to submit %s: %s", frame.name.cStr(),
-					   vkm::vk::reflect::toString(ret).cStr());
+		if ((sequence & 1) != 0) {
+			vkm::std::cpuRelax();
+			continue;
+		}
+
+		const uint32_t count = timestamps.publishedCount.load(vkm::std::memoryOrder::relaxed);
+		const uint64_t frame = timestamps.publishedFrame.load(vkm::std::memoryOrder::relaxed);
+		uint32_t copied = count;
+		if (pResults != nullptr) {
+			copied = vkm::std::min(count, *pCount);
+			memcpy(pResults, timestamps.published.get(), copied * sizeof(vkm_context_timestampResult));
+		}
+
+		vkm::std::atomicThreadFence(vkm::std::memoryOrder::acquire);
+		if (timestamps.sequence.load(vkm::std::memoryOrder::relaxed) != sequence) {
+			continue;
 		}
+		if (pFrame != nullptr) {
+			*pFrame = frame;
+		}
+		*pCount = copied;
+		return copied < count ? VK_INCOMPLETE : VK_SUCCESS;
 	}
-	frame.pendingWaitSemaphores.resize(0);
-	frame.pendingSignalSemaphores.resize(0);
-	frame.submittedCommandBuffers += 1;
-	for (size_t i = 0; i < info.numPrsentInfos; i++) {
-		auto present = info.pPresentInfos[i];
-		auto* swapchain = vkm::vk::swapchain::fromHandle(present.swapchain);
-		*present.pResult = swapchain->present(ctx->vkQueue);
+}
+VKM_FN VkResult vkm_context_getPhaseStats([[maybe_unused]] vkm_context ctxHandle, [[maybe_unused]] vkm_context_phase phase,
+										  [[maybe_unused]] vkm_context_phaseStats* stats) {
+#if VKM_INSTRUMENTATION
+	if (phase >= VKM_CONTEXT_PHASE_COUNT) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Invalid phase: %d", phase);
+	}
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	const auto& ring = ctx->phases[phase];
+	const uint32_t count = static_cast<uint32_t>(vkm::std::min<uint64_t>(ring.count, VKM_CONTEXT_PHASE_MAX_SAMPLES));
+
+	*stats = vkm_context_phaseStats{
+		.count = count,
+	};
+	if (count == 0) {
+		return VK_SUCCESS;
 	}
+
+	vkm::std::array<uint64_t, VKM_CONTEXT_PHASE_MAX_SAMPLES> sorted;
+	uint64_t sum = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		sorted[i] = ring.samples[i];
+		sum += ring.samples[i];
+	}
+	::std::sort(sorted.begin(), sorted.begin() + count);
+
+	stats->min = sorted[0];
+	stats->max = sorted[count - 1];
+	stats->avg = sum / count;
+	stats->p99 = sorted[((count * 99) + 99) / 100 - 1];
+	return VK_SUCCESS;
+#else
+	return VK_ERROR_FEATURE_NOT_PRESENT;
+#endif
+}
+VKM_FN VkResult vkm_context_getPhaseSamples([[maybe_unused]] vkm_context ctxHandle, [[maybe_unused]] vkm_context_phase phase,
+											[[maybe_unused]] uint32_t* pCount, [[maybe_unused]] uint64_t* pSamples) {
+#if VKM_INSTRUMENTATION
+	if (phase >= VKM_CONTEXT_PHASE_COUNT) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Invalid phase: %d", phase);
+	}
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	const auto& ring = ctx->phases[phase];
+	const uint32_t count = static_cast<uint32_t>(vkm::std::min<uint64_t>(ring.count, VKM_CONTEXT_PHASE_MAX_SAMPLES));
+
+	if (pSamples == nullptr) {
+		*pCount = count;
+		return VK_SUCCESS;
+	}
+
+	const uint32_t copied = vkm::std::min(count, *pCount);
+	for (uint32_t i = 0; i < copied; i++) {
+		pSamples[i] = ring.samples[(ring.count - copied + i) % VKM_CONTEXT_PHASE_MAX_SAMPLES];
+	}
+	*pCount = copied;
+	return copied < count ? VK_INCOMPLETE : VK_SUCCESS;
+#else
+	return VK_ERROR_FEATURE_NOT_PRESENT;
+#endif
+}
+VKM_FN void vkm_context_getHighWaterMarks(vkm_context ctxHandle, vkm_context_prewarmInfo* marks) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	ctx->updateHighWaterMarks(ctx->frames[ctx->frameID]);
+	*marks = ctx->highWaterMarks;
+	marks->numFences = ctx->instance->syncObjectManager.getPeakFences();
+}
+VKM_FN void vkm_context_flush(vkm_context ctxHandle) {
+	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	ctx->flush();
 }
 VKM_FN void vkm_context_end(vkm_context ctxHandle) {
 	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
@@ -418,12 +1692,19 @@ VKM_FN void vkm_context_end(vkm_context ctxHandle) {
 	if (frame.acquiredCommandBuffers != frame.submittedCommandBuffers) {
 		vkm::fatal("Cannot end context before ending active command buffer");
 	}
+	for (const auto& pool : frame.threadPools) {
+		if (pool.activeCommandBuffers != 0) {
+			vkm::fatal("Cannot end context before ending every active thread command buffer");
+		}
+	}
 
+	ctx->flush();
 	vkm::std::debugRun([&]() { vkm::vk::debugLabelEnd(ctx->vkQueue); });
 	frame.pendingSemaphoreValue = ctx->semaphore.pendingValue;
 	ctx->frameID = (ctx->frameID + 1) % ctx->frames.size();
 }
 VKM_FN void vkm_context_wait(vkm_context ctxHandle) {
 	auto* ctx = ::vkm::vk::context::fromHandle(ctxHandle);
+	ctx->flush();
 	vkm_semaphore_timeline_wait(ctx->instance->handle(), ctx->semaphore.vkSemaphore, ctx->semaphore.pendingValue);
 }
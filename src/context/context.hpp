@@ -25,6 +25,12 @@ limitations under the License.
 
 #include "vkm/std/string.hpp"
 #include "vkm/std/vector.hpp"
+#include "vkm/std/ringbuffer.hpp"
+#include "vkm/std/atomic.hpp"
+#include "vkm/std/array.hpp"
+#include "vkm/std/time.hpp"
+#include "vkm/std/defer.hpp"
+#include "vkm/std/thread.hpp"
 #include "vkm/std/utility.hpp"
 
 #include "vkm/vkm.h"
@@ -32,6 +38,10 @@ limitations under the License.
 #include "device/device.hpp"
 #include "device/vma/vma.hpp"
 
+#ifndef VKM_INSTRUMENTATION
+#define VKM_INSTRUMENTATION 0
+#endif
+
 namespace vkm::vk {
 struct context {
 	device::instance* instance;
@@ -39,12 +49,21 @@ struct context {
 	uint32_t queueFamily;
 	VkQueue vkQueue;
 	VmaPool vmaPool;
+	bool deferSubmit;
+
+	struct {
+		VkDeviceSize blockSize;
+		VkBufferUsageFlags usage;
+		VkDeviceSize defaultAlignment;
+	} scratchBlockInfo;
 
 	uint32_t frameID = 0;
 
 	struct {
 		uint64_t pendingValue;
 		VkSemaphore vkSemaphore;
+		// registered on the device with the last value flushed
+		device::submittedTimeline submitted;
 	} semaphore;
 	struct frame {
 		vkm::std::string<char> name;
@@ -55,16 +74,210 @@ struct context {
 		size_t submittedCommandBuffers;
 		vkm::std::vector<VkCommandBuffer> commandBuffers;
 
+		struct threadPool {
+			VkCommandPool vkCommandPool;
+			// begun but not yet ended
+			size_t activeCommandBuffers;
+			size_t acquiredPrimaryCommandBuffers;
+			size_t acquiredSecondaryCommandBuffers;
+			vkm::std::vector<VkCommandBuffer> primaryCommandBuffers;
+			vkm::std::vector<VkCommandBuffer> secondaryCommandBuffers;
+		};
+		// indexed by thread index, each is only ever touched by the thread recording with that index
+		vkm::std::vector<threadPool> threadPools;
+
+		// number acquired this frame, pendingBinarySemaphores is emptied on every submit
+		size_t acquiredBinarySemaphores;
 		vkm::std::vector<VkSemaphore> pendingBinarySemaphores;
 		vkm::std::vector<vkm::std::pair<VkBuffer, VmaAllocation>> pendingScratchBuffers;
+
+		struct scratchBlock {
+			VkBuffer vkBuffer;
+			VmaAllocation vmaAllocation;
+			VkDeviceSize size;
+			uint8_t* ptr;
+		};
+		// blocks are kept alive across frames, begin only rewinds the bump offset
+		vkm::std::vector<scratchBlock> scratchBlocks;
+		size_t scratchBlockIndex;
+		VkDeviceSize scratchBlockOffset;
+
 		vkm::std::vector<VkSemaphoreSubmitInfo> pendingWaitSemaphores;
-		vkm::std::vector<VkSemaphoreSubmitInfo> pendingSignalSemaphores;
+
+		struct pendingSubmit {
+			const void* pNext;
+			VkSubmitFlags flags;
+			// offsets index into the pendingSubmit* vectors, as they may grow before the flush
+			uint32_t waitSemaphoreOffset;
+			uint32_t numWaitSemaphores;
+			uint32_t commandBufferOffset;
+			uint32_t numCommandBuffers;
+			uint32_t signalSemaphoreOffset;
+			uint32_t numSignalSemaphores;
+		};
+		vkm::std::vector<pendingSubmit> pendingSubmits;
+		vkm::std::vector<VkCommandBufferSubmitInfo> pendingSubmitCommandBuffers;
+		vkm::std::vector<VkSemaphoreSubmitInfo> pendingSubmitWaitSemaphores;
+		vkm::std::vector<VkSemaphoreSubmitInfo> pendingSubmitSignalSemaphores;
+		vkm::std::vector<vkm_swapchain_presentInfo> pendingPresents;
 
 		vkm::std::vector<vkm_destroyer> pendingDestroyers;
+
+		struct timestampScope {
+			vkm_context_timestampResult result;
+			VkCommandBuffer cb;
+			// the scope owns query and query + 1, UINT32_MAX if the pool was full
+			uint32_t query;
+		};
+		struct {
+			VkQueryPool vkQueryPool;
+			uint64_t frameNumber;
+			uint32_t usedQueries;
+			vkm::std::vector<timestampScope> scopes;
+			vkm::std::vector<uint32_t> openScopes;
+		} timestamps;
 	};
 	vkm::std::vector<frame> frames;
+	vkm::std::vector<VkSubmitInfo2> submitInfos;
+
+	// resources released as soon as the timeline reaches the paired value instead of when the frame slot comes back
+	vkm::std::vector<vkm::std::pair<uint64_t, vkm_destroyer>> retiringDestroyers;
+	vkm::std::vector<vkm::std::pair<uint64_t, vkm::std::pair<VkBuffer, VmaAllocation>>> retiringScratchBuffers;
+	vkm::std::vector<vkm::std::pair<uint64_t, VkSemaphore>> retiringBinarySemaphores;
+	vkm::std::vector<vkm_destroyer> retiredDestroyers;
+
+	struct {
+		// number of queries per frame, 0 if disabled
+		uint32_t numQueries;
+		float period;
+		uint64_t validMask;
+		uint64_t frameNumber;
+		vkm::std::vector<uint64_t> queryResults;
+
+		// seqlock guarding published, odd while being written
+		vkm::std::atomic<uint64_t> sequence;
+		vkm::std::atomic<uint64_t> publishedFrame;
+		vkm::std::atomic<uint32_t> publishedCount;
+		// sized at creation and never resized so readers never see it move
+		vkm::std::vector<vkm_context_timestampResult> published;
+	} timestamps;
+
+	// only started when created with backgroundDestroyers, runs batches of destroyers handed over by beginFrame
+	// once their frame has been waited on, in the order they were handed over
+	struct {
+		bool enabled;
+		bool stop;
+		bool busy;
+		vkm::std::mutex mutex;
+		vkm::std::conditionVariable wake;
+		vkm::std::conditionVariable idle;
+		vkm::std::ringbuffer<vkm::std::vector<vkm_destroyer>> pendingBatches;
+		vkm::std::vector<vkm::std::vector<vkm_destroyer>> freeBatches;
+		vkm::std::thread thread;
+	} destroyerThread;
+
+#if VKM_INSTRUMENTATION
+	struct phaseRing {
+		vkm::std::array<uint64_t, VKM_CONTEXT_PHASE_MAX_SAMPLES> samples;
+		// total number of samples ever recorded, the ring holds the last min(count, VKM_CONTEXT_PHASE_MAX_SAMPLES)
+		uint64_t count;
+	};
+	vkm::std::array<phaseRing, VKM_CONTEXT_PHASE_COUNT> phases;
+
+	void recordPhase(vkm_context_phase phase, uint64_t duration) noexcept {
+		auto& ring = this->phases[phase];
+		ring.samples[ring.count % VKM_CONTEXT_PHASE_MAX_SAMPLES] = duration;
+		ring.count += 1;
+	}
+#endif
+
+	vkm_context_prewarmInfo highWaterMarks;
+
+	// host cached buffers copied into by vkm_context_readbackBuffer, indexed by vkm_readbackTicket::slot.
+	// guarded by mutex as tickets may be mapped and released from other threads
+	struct readbackBuffer {
+		VkBuffer vkBuffer;
+		VmaAllocation vmaAllocation;
+		VkDeviceSize size;
+		const uint8_t* ptr;
+		bool inUse;
+		// bumped every time the buffer is handed out, a ticket from an earlier use no longer matches it
+		uint32_t generation;
+	};
+	struct {
+		vkm::std::mutex mutex;
+		vkm::std::vector<readbackBuffer> buffers;
+	} readbacks;
+	// value the active command buffer will signal once set by readbacks or defragmentation passes recorded into it,
+	// nothing else may be submitted before that command buffer ends. only touched by the recording thread
+	uint64_t activeCommandBufferValue;
+
+	// an incremental defragmentation of the device's movable pools driven by vkm_context_defragment
+	struct {
+		// null when not defragmenting
+		VmaDefragmentationContext vmaContext;
+		// the pools are defragmented one after the other, this indexes the device's movablePools
+		size_t poolIndex;
+		// summed over the pools already done
+		vkm_context_defragStats stats;
+		VmaDefragmentationPassMoveInfo pass;
+		bool passActive;
+		// the pass' copies are done once the context's semaphore reaches this
+		uint64_t passValue;
+		// handles replaced during the pass, destroyed when it ends
+		vkm::std::vector<vkm_context_defragMove> moves;
+	} defrag;
+
+	// hands the destroyers to destroyerThread and replaces them with an empty recycled batch
+	void retireDestroyers(vkm::std::vector<vkm_destroyer>& destroyers) noexcept;
+	// blocks until destroyerThread has run every batch handed to it
+	void flushDestroyers() noexcept;
+	void beginTimestampScope(frame& frame, VkCommandBuffer cb, vkm_string name) noexcept;
+	void endTimestampScope(frame& frame, VkCommandBuffer cb) noexcept;
+	// reads back the queries of a completed frame, publishes them and resets the pool
+	void resolveTimestamps(frame& frame) noexcept;
+	// destroys the handles the pass replaced and ends it, returns whatever vmaEndDefragmentationPass does
+	VkResult endDefragmentPass() noexcept;
+	// begins defragmenting the pool at defrag.poolIndex, returns false if there is no such pool
+	[[nodiscard]] bool beginDefragmentPool(const vkm_context_defragInfo& info) noexcept;
+	// ends defragmenting the current pool, adds its stats to defrag.stats and moves on to the next index
+	void endDefragmentPool() noexcept;
+	// ends the defragmentation whether every pool is done or not
+	void endDefragment(vkm_context_defragStats* stats) noexcept;
+	// folds the frame's usage into highWaterMarks
+	void updateHighWaterMarks(const frame& frame) noexcept;
+	// everything vkm_context_begin does once the frame's pending semaphore value has been reached
+	void beginFrame(vkm_string name) noexcept;
+	// releases every retiring resource whose value <= completedValue
+	void retire(uint64_t completedValue) noexcept;
+	// records a submit of the command buffers in order to be sent on the next flush,
+	// returns the timeline value the submit signals
+	[[nodiscard]] uint64_t recordSubmit(frame& frame, size_t numCommandBuffers, const VkCommandBuffer* commandBuffers,
+										const vkm_context_commandBufferEndInfo& info) noexcept;
+	// submits all pending submits of the current frame in a single vkQueueSubmit2 then presents
+	void flush() noexcept;
 
 	[[nodiscard]] vkm_context handle() noexcept { return reinterpret_cast<vkm_context>(this); }
 	[[nodiscard]] static context* fromHandle(vkm_context handle) noexcept { return reinterpret_cast<context*>(handle); }
 };
+
+#if VKM_INSTRUMENTATION
+// records the time until the end of the enclosing scope into the context's phase ring
+struct phaseTimer {
+	context* ctx;
+	vkm_context_phase phase;
+	uint64_t start;
+
+	phaseTimer(const phaseTimer&) = delete;
+	phaseTimer& operator=(const phaseTimer&) = delete;
+
+	phaseTimer(context* ctx, vkm_context_phase phase) noexcept
+		: ctx(ctx), phase(phase), start(vkm::std::time::now()) {}
+	~phaseTimer() noexcept { ctx->recordPhase(phase, vkm::std::time::now() - start); }
+};
+#define VKM_CONTEXT_PHASE(ctx, phase) \
+	const ::vkm::vk::phaseTimer DEFER_CONCAT(_phaseTimer, __LINE__)((ctx), (phase))
+#else
+#define VKM_CONTEXT_PHASE(ctx, phase)
+#endif
 }  // namespace vkm::vk
@@ -36,10 +36,21 @@ instance::instance(vkm_deviceInitInfo info) noexcept
 	: vkPhysicalDevice(info.vkPhysicalDevice),
 	  vkDevice(info.vkDevice),
 	  owned(info.gainOwnership == VK_TRUE),
-	  optionalFeatures({.hasEXTSwapchainMaint1 = info.optionalFeatures.extSwapchainMaint1 == VK_TRUE}),
-	  syncObjectManager(this) {}
+	  optionalFeatures({
+		  .hasEXTSwapchainMaint1 = info.optionalFeatures.extSwapchainMaint1 == VK_TRUE,
+		  .hasHostQueryReset = info.optionalFeatures.hostQueryReset == VK_TRUE,
+		  .hasEXTMemoryPriority = info.optionalFeatures.extMemoryPriority == VK_TRUE,
+		  .hasEXTPageableDeviceLocalMemory = info.optionalFeatures.extPageableDeviceLocalMemory == VK_TRUE,
+		  .hasSparseBinding = info.optionalFeatures.sparseBinding == VK_TRUE,
+		  .hasSparseResidencyBuffer = info.optionalFeatures.sparseResidencyBuffer == VK_TRUE,
+		  .hasSparseResidencyImage2D = info.optionalFeatures.sparseResidencyImage2D == VK_TRUE,
+		  .hasSparseResidencyImage3D = info.optionalFeatures.sparseResidencyImage3D == VK_TRUE,
+	  }),
+	  syncObjectManager(this),
+	  timelineWaiter(this) {}
 instance::~instance() noexcept {
 	static constexpr vkm::std::array deviceDestructors = {
+		&destroyWaiter,
 		&destroyVMA,
 		&destroySync,
 	};
@@ -181,4 +192,55 @@ VKM_FN VkResult vkm_device_waitIdle(vkm_device instanceHandle) {
 	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
 	return VK_PROC_DEVICE(instance, vkDeviceWaitIdle)(instance->vkDevice);
 }
+VKM_FN void vkm_device_setWaitPolicy(vkm_device instanceHandle, vkm_device_waitPolicy policy) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	instance->waitPolicy.spinBudget.store(policy.spinBudget, vkm::std::memoryOrder::relaxed);
+}
+VKM_FN void vkm_device_getWaitStats(vkm_device instanceHandle, vkm_device_waitStats* stats) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	*stats = vkm_device_waitStats{
+		.alreadyReached = instance->waitPolicy.alreadyReached.load(vkm::std::memoryOrder::relaxed),
+		.spinWins = instance->waitPolicy.spinWins.load(vkm::std::memoryOrder::relaxed),
+		.blockingWaits = instance->waitPolicy.blockingWaits.load(vkm::std::memoryOrder::relaxed),
+		.timeouts = instance->waitPolicy.timeouts.load(vkm::std::memoryOrder::relaxed),
+	};
+}
+VKM_FN void vkm_device_getMemoryBudget(vkm_device instanceHandle, uint32_t* pCount, vkm_device_heapBudget* pBudgets) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	::vkm::vk::device::getHeapBudgets(instance, pCount, pBudgets);
+}
+VKM_FN void vkm_device_setMemoryWatermarks(vkm_device instanceHandle, uint32_t count,
+										   const vkm_device_memoryWatermark* watermarks) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+
+	instance->memoryWatermarks.mutex.lock();
+	instance->memoryWatermarks.watermarks.resize(0);
+	for (uint32_t i = 0; i < count; i++) {
+		instance->memoryWatermarks.watermarks.pushBack({
+			.info = watermarks[i],
+			.aboveHeaps = 0,
+		});
+	}
+	instance->memoryWatermarks.mutex.unlock();
+}
+VKM_FN VkResult vkm_device_setAllocationPriority(vkm_device instanceHandle, vkm_allocation allocation, float priority) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	if (!instance->optionalFeatures.hasEXTPageableDeviceLocalMemory) {
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+	}
+	if (priority < 0.0f || priority > 1.0f) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Allocation priority %f is outside of [0, 1]",
+				   static_cast<double>(priority));
+	}
+
+	VmaAllocationInfo2 allocInfo;
+	vmaGetAllocationInfo2(instance->vma.allocator, reinterpret_cast<VmaAllocation>(allocation), &allocInfo);
+	// the priority belongs to the whole VkDeviceMemory, which a block shares with every other allocation in it
+	if (allocInfo.dedicatedMemory == VK_FALSE) {
+		return VK_ERROR_NOT_PERMITTED_KHR;
+	}
+	VKM_DEVICE_VKFN(instance, vkSetDeviceMemoryPriorityEXT)(instance->vkDevice, allocInfo.allocationInfo.deviceMemory,
+															 priority);
+	return VK_SUCCESS;
+}
 }
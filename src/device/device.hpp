@@ -23,9 +23,13 @@ limitations under the License.
 #include <stdint.h>
 
 #include "vkm/std/array.hpp"
+#include "vkm/std/atomic.hpp"
+#include "vkm/std/thread.hpp"
+#include "vkm/std/vector.hpp"
 
 #include "vkm/vkm.h"
 #include "device/sync/sync.hpp"
+#include "device/sync/waiter.hpp"
 #include "device/vma/vma.hpp"
 
 #define VKM_UUID_VID_OFFSET 0
@@ -34,18 +38,67 @@ limitations under the License.
 #define VKM_UUID_DID_OFFSET 10
 
 namespace vkm::vk::device {
+// timeline semaphore of a context or uploader and the last value submitted to signal it
+struct submittedTimeline {
+	VkSemaphore vkSemaphore;
+	vkm::std::atomic<uint64_t> value;
+};
+
 struct instance {
 	const VkPhysicalDevice vkPhysicalDevice;  // NOLINT(misc-misplaced-const)
 	const VkDevice vkDevice;				  // NOLINT(misc-misplaced-const)
 	const bool owned;
 	struct {
 		bool hasEXTSwapchainMaint1;
+		bool hasHostQueryReset;
+		bool hasEXTMemoryPriority;
+		bool hasEXTPageableDeviceLocalMemory;
+		bool hasSparseBinding;
+		bool hasSparseResidencyBuffer;
+		bool hasSparseResidencyImage2D;
+		bool hasSparseResidencyImage3D;
 	} optionalFeatures;
 
 	vkm::std::array<PFN_vkVoidFunction, VKM_DEVICE_VKFN_COUNT> vkfns;
 
 	syncObjectManager syncObjectManager;
+	timelineWaiter timelineWaiter;
+
+	struct {
+		// ns to spin on the semaphore counter before a blocking vkWaitSemaphores, 0 always blocks
+		vkm::std::atomic<uint64_t> spinBudget;
+		vkm::std::atomic<uint64_t> alreadyReached;
+		vkm::std::atomic<uint64_t> spinWins;
+		vkm::std::atomic<uint64_t> blockingWaits;
+		vkm::std::atomic<uint64_t> timeouts;
+	} waitPolicy;
 	struct vma vma;
+	struct {
+		struct watermark {
+			vkm_device_memoryWatermark info;
+			// bit i is set while heap i is at or above the watermark
+			uint32_t aboveHeaps;
+		};
+		vkm::std::mutex mutex;
+		vkm::std::vector<watermark> watermarks;
+		// passed to vmaSetCurrentFrameIndex so VMA refreshes its budget
+		vkm::std::atomic<uint32_t> frameIndex;
+	} memoryWatermarks;
+	// set while a context is defragmenting the movable pools
+	vkm::std::atomic<bool> defragmenting;
+	// source allocations of the defragmentation pass in flight, destroying one of them is deferred until it ends
+	struct {
+		vkm::std::mutex mutex;
+		vkm::std::vector<VmaAllocation> moving;
+		vkm::std::vector<VmaAllocation> destroyed;
+	} defragPass;
+	// timelines of every context and uploader, a defragmentation pass waits on all of them before copying
+	struct {
+		vkm::std::mutex mutex;
+		vkm::std::vector<submittedTimeline*> registered;
+		// semaphores unregistered while defragmenting, a pass recorded but not yet submitted may still wait on them
+		vkm::std::vector<VkSemaphore> retired;
+	} timelines;
 
 	vkm_device_properties properties;
 
@@ -67,7 +120,34 @@ void setupProperties(vkm::vk::device::instance*) noexcept;
 void setupVKFNs(vkm::vk::device::instance*) noexcept;
 void setupVMA(vkm::vk::device::instance*) noexcept;
 void destroyVMA(vkm::vk::device::instance*) noexcept;
+// allocates memory for count resources, runs of identical requirements share one vmaAllocateMemoryPages call
+// and are retried one by one if it fails. failed allocations are set to null with their result in results
+// when movable each run is placed in the movable pool of its memory type, createInfo.pool is ignored
+void allocateMemoryBatch(vkm::vk::device::instance*, const VmaAllocationCreateInfo&, bool movable, uint32_t count,
+						 const VkMemoryRequirements*, VmaAllocation*, VkResult* results) noexcept;
+// returns the pool device buffers and images of the memory type are allocated from, creating it on first use
+[[nodiscard]] VmaPool movablePool(vkm::vk::device::instance*, uint32_t memoryTypeIndex) noexcept;
+// returns true if the allocation is being moved by the defragmentation pass in flight, in which case the pass frees it
+// and destroys its handles when it ends instead of the caller
+[[nodiscard]] bool deferDefragDestroy(vkm::vk::device::instance*, VmaAllocation) noexcept;
+void getHeapBudgets(vkm::vk::device::instance*, uint32_t* count, vkm_device_heapBudget*) noexcept;
+// called from vkm_context_begin, advances the VMA frame index and runs the callbacks of crossed watermarks
+void evaluateMemoryWatermarks(vkm::vk::device::instance*) noexcept;
 void destroySync(vkm::vk::device::instance*) noexcept;
+void destroyWaiter(vkm::vk::device::instance*) noexcept;
+void registerTimeline(vkm::vk::device::instance*, submittedTimeline*) noexcept;
+// destroys the semaphore, or retires it until the defragmentation ends if one is in progress
+void unregisterTimeline(vkm::vk::device::instance*, submittedTimeline*) noexcept;
+// pushes a wait on the submitted value of every registered timeline except skip
+void appendTimelineWaits(vkm::vk::device::instance*, const submittedTimeline* skip,
+						 vkm::std::vector<VkSemaphoreSubmitInfo>&) noexcept;
+// destroys the semaphores retired during the defragmentation, every submit that could wait on them must be done
+void destroyRetiredTimelines(vkm::vk::device::instance*) noexcept;
+// returns false if the semaphore is a registered timeline that has not been submitted up to value yet
+[[nodiscard]] bool timelineSubmitted(vkm::vk::device::instance*, VkSemaphore, uint64_t value) noexcept;
+// vkWaitSemaphores following the device's waitPolicy, returns whatever vkWaitSemaphores would
+VkResult waitSemaphores(vkm::vk::device::instance*, uint32_t count, const VkSemaphore*, const uint64_t* values,
+						VkSemaphoreWaitFlags, uint64_t timeout) noexcept;
 }  // namespace vkm::vk::device
 
 #define VK_PROC_DEVICE(device, FN) ((PFN_##FN)(device)->procAddr(VKM_DEVICE_VKFN_##FN))
@@ -14,6 +14,14 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include "vkm/std/atomic.hpp"
+#include "vkm/std/time.hpp"
+#include "vkm/std/utility.hpp"
+#include "vkm/std/stdlib.hpp"
+#include "vkm/std/defer.hpp"
+
+#include "vkm.hpp"
+#include "reflect_const.hpp"
 #include "device/sync/sync.hpp"
 #include "device/device.hpp"
 
@@ -21,4 +29,136 @@ namespace vkm::vk::device {
 void destroySync(vkm::vk::device::instance* device) noexcept {
 	device->syncObjectManager.clear();
 }
+void destroyWaiter(vkm::vk::device::instance* device) noexcept {
+	device->timelineWaiter.shutdown();
+}
+
+void registerTimeline(vkm::vk::device::instance* device, submittedTimeline* timeline) noexcept {
+	device->timelines.mutex.lock();
+	DEFER([&] { device->timelines.mutex.unlock(); });
+	device->timelines.registered.pushBack(timeline);
+}
+void unregisterTimeline(vkm::vk::device::instance* device, submittedTimeline* timeline) noexcept {
+	auto& timelines = device->timelines;
+	timelines.mutex.lock();
+	DEFER([&] { timelines.mutex.unlock(); });
+	for (size_t i = 0; i < timelines.registered.size(); i++) {
+		if (timelines.registered[i] == timeline) {
+			timelines.registered[i] = timelines.registered.last();
+			timelines.registered.popBack();
+			break;
+		}
+	}
+	// checked under the mutex so a pass that saw this timeline also sees it retired
+	if (device->defragmenting.load()) {
+		timelines.retired.pushBack(timeline->vkSemaphore);
+	} else {
+		VK_PROC_DEVICE(device, vkDestroySemaphore)(device->vkDevice, timeline->vkSemaphore, nullptr);
+	}
+}
+void appendTimelineWaits(vkm::vk::device::instance* device, const submittedTimeline* skip,
+						 vkm::std::vector<VkSemaphoreSubmitInfo>& waits) noexcept {
+	device->timelines.mutex.lock();
+	DEFER([&] { device->timelines.mutex.unlock(); });
+	for (const auto* timeline : device->timelines.registered) {
+		const uint64_t value = timeline->value.load(vkm::std::memoryOrder::acquire);
+		if (timeline == skip || value == 0) {
+			continue;
+		}
+		waits.pushBack(VkSemaphoreSubmitInfo{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = timeline->vkSemaphore,
+			.value = value,
+			.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+		});
+	}
+}
+void destroyRetiredTimelines(vkm::vk::device::instance* device) noexcept {
+	device->timelines.mutex.lock();
+	DEFER([&] { device->timelines.mutex.unlock(); });
+	for (VkSemaphore semaphore : device->timelines.retired) {
+		VK_PROC_DEVICE(device, vkDestroySemaphore)(device->vkDevice, semaphore, nullptr);
+	}
+	device->timelines.retired.resize(0);
+}
+bool timelineSubmitted(vkm::vk::device::instance* device, VkSemaphore semaphore, uint64_t value) noexcept {
+	device->timelines.mutex.lock();
+	DEFER([&] { device->timelines.mutex.unlock(); });
+	for (const auto* timeline : device->timelines.registered) {
+		if (timeline->vkSemaphore == semaphore) {
+			return timeline->value.load(vkm::std::memoryOrder::acquire) >= value;
+		}
+	}
+	return true;
+}
+
+static bool semaphoresReached(vkm::vk::device::instance* device, uint32_t count, const VkSemaphore* semaphores,
+							  const uint64_t* values, VkSemaphoreWaitFlags flags) noexcept {
+	const bool any = (flags & VK_SEMAPHORE_WAIT_ANY_BIT) != 0;
+	for (uint32_t i = 0; i < count; i++) {
+		uint64_t value = 0;
+		const VkResult ret = VK_PROC_DEVICE(device, vkGetSemaphoreCounterValue)(device->vkDevice, semaphores[i], &value);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed getting semaphore value: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+		if (any && value >= values[i]) {
+			return true;
+		}
+		if (!any && value < values[i]) {
+			return false;
+		}
+	}
+	return !any;
+}
+VkResult waitSemaphores(vkm::vk::device::instance* device, uint32_t count, const VkSemaphore* semaphores, const uint64_t* values,
+						VkSemaphoreWaitFlags flags, uint64_t timeout) noexcept {
+	auto& policy = device->waitPolicy;
+	const uint64_t spinBudget = policy.spinBudget.load(vkm::std::memoryOrder::relaxed);
+
+	// checked for every policy so the stats mean the same thing whatever the spin budget
+	if (semaphoresReached(device, count, semaphores, values, flags)) {
+		policy.alreadyReached.fetchAdd(1, vkm::std::memoryOrder::relaxed);
+		return VK_SUCCESS;
+	}
+
+	uint64_t remaining = timeout;
+	if (spinBudget > 0) {
+		const uint64_t start = vkm::std::time::now();
+		const uint64_t budget = vkm::std::min(spinBudget, timeout);
+		uint64_t elapsed = 0;
+		while (elapsed < budget) {
+			for (int i = 0; i < 16; i++) {
+				vkm::std::cpuRelax();
+			}
+			if (semaphoresReached(device, count, semaphores, values, flags)) {
+				policy.spinWins.fetchAdd(1, vkm::std::memoryOrder::relaxed);
+				return VK_SUCCESS;
+			}
+			elapsed = vkm::std::time::now() - start;
+		}
+		if (elapsed >= timeout) {
+			policy.timeouts.fetchAdd(1, vkm::std::memoryOrder::relaxed);
+			return VK_TIMEOUT;
+		}
+		if (timeout != UINT64_MAX) {
+			remaining = timeout - elapsed;
+		}
+	}
+
+	const VkSemaphoreWaitInfo waitInfo = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.flags = flags,
+		.semaphoreCount = count,
+		.pSemaphores = semaphores,
+		.pValues = values,
+	};
+	const VkResult ret = VK_PROC_DEVICE(device, vkWaitSemaphores)(device->vkDevice, &waitInfo, remaining);
+	if (ret == VK_TIMEOUT) {
+		policy.timeouts.fetchAdd(1, vkm::std::memoryOrder::relaxed);
+	} else {
+		policy.blockingWaits.fetchAdd(1, vkm::std::memoryOrder::relaxed);
+	}
+	return ret;
+}
 }  // namespace vkm::vk::device
@@ -16,8 +16,10 @@ limitations under the License.
 
 #include <stdint.h>
 
+#include "vkm/std/defer.hpp"
 #include "vkm/std/utility.hpp"
 #include "vkm/std/stdlib.hpp"
+#include "vkm/std/string.hpp"
 
 #include "vkm/vkm.h"
 #include "vkm.hpp"
@@ -67,6 +69,9 @@ void setupVMA(vkm::vk::device::instance* device) noexcept {
 	allocatorInfo.vulkanApiVersion = device->properties.api;
 	allocatorInfo.flags = VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT | VMA_ALLOCATOR_CREATE_KHR_MAINTENANCE4_BIT
 						  | VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+	if (device->optionalFeatures.hasEXTMemoryPriority) {
+		allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_PRIORITY_BIT;
+	}
 
 	const VkResult ret = vmaCreateAllocator(&allocatorInfo, &device->vma.allocator);
 	if (ret != VK_SUCCESS) {
@@ -88,6 +93,159 @@ void setupVMA(vkm::vk::device::instance* device) noexcept {
 }
 
 void destroyVMA(vkm::vk::device::instance* device) noexcept {
+	for (const auto& pool : device->vma.movablePools) {
+		vmaDestroyPool(device->vma.allocator, pool.second);
+	}
 	vmaDestroyAllocator(device->vma.allocator);
 }
+
+VmaPool movablePool(vkm::vk::device::instance* device, uint32_t memoryTypeIndex) noexcept {
+	device->vma.movablePoolsMutex.lock();
+	DEFER([&] { device->vma.movablePoolsMutex.unlock(); });
+	for (const auto& pool : device->vma.movablePools) {
+		if (pool.first == memoryTypeIndex) {
+			return pool.second;
+		}
+	}
+
+	VmaPoolCreateInfo poolInfo = {};
+	poolInfo.memoryTypeIndex = memoryTypeIndex;
+	// blocks of the default pools get the default priority too
+	poolInfo.priority = 0.5f;
+
+	VmaPool pool;
+	const VkResult ret = vmaCreatePool(device->vma.allocator, &poolInfo, &pool);
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create movable pool: %s",
+				   vkm::vk::reflect::toString(ret).cStr());
+	}
+	vkm::std::debugRun([&]() {
+		vkm::std::stringbuilder builder;
+		builder << "movable_pool_" << memoryTypeIndex;
+		vmaSetPoolName(device->vma.allocator, pool, builder.cStr());
+	});
+	device->vma.movablePools.pushBack(vkm::std::pair{memoryTypeIndex, pool});
+	return pool;
+}
+
+void allocateMemoryBatch(vkm::vk::device::instance* device, const VmaAllocationCreateInfo& createInfo, bool movable,
+						 uint32_t count, const VkMemoryRequirements* requirements, VmaAllocation* allocations,
+						 VkResult* results) noexcept {
+	// VMA_MEMORY_USAGE_AUTO* needs the resource create info which vmaAllocateMemory never sees,
+	// the required flags and memory type bits already pin down the memory type
+	VmaAllocationCreateInfo allocCreateInfo = createInfo;
+	if (allocCreateInfo.usage == VMA_MEMORY_USAGE_AUTO || allocCreateInfo.usage == VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+		|| allocCreateInfo.usage == VMA_MEMORY_USAGE_AUTO_PREFER_HOST) {
+		allocCreateInfo.usage = VMA_MEMORY_USAGE_UNKNOWN;
+	}
+	const auto same = [](const VkMemoryRequirements& a, const VkMemoryRequirements& b) -> bool {
+		return a.size == b.size && a.alignment == b.alignment && a.memoryTypeBits == b.memoryTypeBits;
+	};
+	for (uint32_t begin = 0; begin < count;) {
+		uint32_t end = begin + 1;
+		while (end < count && same(requirements[begin], requirements[end])) {
+			end++;
+		}
+
+		VkResult ret = VK_ERROR_UNKNOWN;
+		if (movable) {
+			allocCreateInfo.pool = nullptr;
+			uint32_t memoryTypeIndex;
+			ret = vmaFindMemoryTypeIndex(device->vma.allocator, requirements[begin].memoryTypeBits, &allocCreateInfo,
+										 &memoryTypeIndex);
+			if (ret != VK_SUCCESS) {
+				for (uint32_t i = begin; i < end; i++) {
+					results[i] = ret;
+					allocations[i] = nullptr;
+				}
+				begin = end;
+				continue;
+			}
+			allocCreateInfo.pool = movablePool(device, memoryTypeIndex);
+			ret = VK_ERROR_UNKNOWN;
+		}
+		if (end - begin > 1) {
+			ret = vmaAllocateMemoryPages(device->vma.allocator, &requirements[begin], &allocCreateInfo, end - begin,
+										 &allocations[begin], nullptr);
+			for (uint32_t i = begin; i < end; i++) {
+				results[i] = ret;
+			}
+		}
+		if (ret != VK_SUCCESS) {
+			// pages are all or nothing, find out which ones actually fail
+			for (uint32_t i = begin; i < end; i++) {
+				results[i] = vmaAllocateMemory(device->vma.allocator, &requirements[i], &allocCreateInfo, &allocations[i], nullptr);
+				if (results[i] != VK_SUCCESS) {
+					allocations[i] = nullptr;
+				}
+			}
+		}
+		begin = end;
+	}
+}
+
+bool deferDefragDestroy(vkm::vk::device::instance* device, VmaAllocation allocation) noexcept {
+	device->defragPass.mutex.lock();
+	DEFER([&] { device->defragPass.mutex.unlock(); });
+	if (!device->defragPass.moving.contains(allocation)) {
+		return false;
+	}
+	device->defragPass.destroyed.pushBack(allocation);
+	return true;
+}
+
+void getHeapBudgets(vkm::vk::device::instance* device, uint32_t* count, vkm_device_heapBudget* budgets) noexcept {
+	const VkPhysicalDeviceMemoryProperties* properties;
+	vmaGetMemoryProperties(device->vma.allocator, &properties);
+	if (budgets == nullptr) {
+		*count = properties->memoryHeapCount;
+		return;
+	}
+
+	VmaBudget vmaBudgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetHeapBudgets(device->vma.allocator, vmaBudgets);
+	*count = vkm::std::min(*count, properties->memoryHeapCount);
+	for (uint32_t i = 0; i < *count; i++) {
+		budgets[i] = vkm_device_heapBudget{
+			.flags = properties->memoryHeaps[i].flags,
+			.usage = vmaBudgets[i].usage,
+			.budget = vmaBudgets[i].budget,
+			.blockCount = vmaBudgets[i].statistics.blockCount,
+			.blockBytes = vmaBudgets[i].statistics.blockBytes,
+			.allocationCount = vmaBudgets[i].statistics.allocationCount,
+			.allocationBytes = vmaBudgets[i].statistics.allocationBytes,
+		};
+	}
+}
+
+void evaluateMemoryWatermarks(vkm::vk::device::instance* device) noexcept {
+	vmaSetCurrentFrameIndex(device->vma.allocator, device->memoryWatermarks.frameIndex.fetchAdd(1) + 1);
+
+	device->memoryWatermarks.mutex.lock();
+	DEFER([&] { device->memoryWatermarks.mutex.unlock(); });
+	if (device->memoryWatermarks.watermarks.size() == 0) {
+		return;
+	}
+
+	uint32_t count = VK_MAX_MEMORY_HEAPS;
+	vkm_device_heapBudget budgets[VK_MAX_MEMORY_HEAPS];
+	getHeapBudgets(device, &count, budgets);
+
+	for (auto& w : device->memoryWatermarks.watermarks) {
+		const uint32_t heapMask = w.info.heapMask != 0 ? w.info.heapMask : UINT32_MAX;
+		for (uint32_t i = 0; i < count; i++) {
+			if ((heapMask & (1u << i)) == 0 || budgets[i].budget == 0) {
+				continue;
+			}
+			const bool above = static_cast<double>(budgets[i].usage)
+							   >= static_cast<double>(w.info.threshold) * static_cast<double>(budgets[i].budget);
+			const bool wasAbove = (w.aboveHeaps & (1u << i)) != 0;
+			if (above == wasAbove) {
+				continue;
+			}
+			w.aboveHeaps ^= 1u << i;
+			w.info.fn(w.info.userdata, i, budgets[i], above ? VK_TRUE : VK_FALSE);
+		}
+	}
+}
 }  // namespace vkm::vk::device
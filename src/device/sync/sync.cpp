@@ -16,6 +16,7 @@ limitations under the License.
 
 #include "device/sync/sync.hpp"
 
+#include "vkm/std/defer.hpp"
 #include "vkm/std/stdlib.hpp"
 
 #include "vkm.hpp"
@@ -27,20 +28,39 @@ namespace vkm::vk::device {
 syncObjectManager::syncObjectManager(struct instance* instance) noexcept : instance(instance) {}
 
 void syncObjectManager::clear() {
-	for (VkSemaphore s : this->freeSemaphores) {
+	VkSemaphore s;
+	while (this->freeSemaphores.pop(&s)) {
 		VK_PROC_DEVICE(this->instance, vkDestroySemaphore)(this->instance->vkDevice, s, nullptr);
 	}
-	for (VkFence f : this->freeFences) {
+	VkFence f;
+	while (this->freeFences.pop(&f)) {
+		VK_PROC_DEVICE(this->instance, vkDestroyFence)(this->instance->vkDevice, f, nullptr);
+	}
+	// the device is idle by the time it is destroyed so pending fences are no longer in use
+	while (this->releasedFences.pop(&f)) {
+		VK_PROC_DEVICE(this->instance, vkDestroyFence)(this->instance->vkDevice, f, nullptr);
+	}
+	while (this->pendingFences.size() > 0) {
+		f = this->pendingFences.dequeueFront();
 		VK_PROC_DEVICE(this->instance, vkDestroyFence)(this->instance->vkDevice, f, nullptr);
 	}
-	this->freeSemaphores.resize(0);
-	this->freeFences.resize(0);
 }
 
-VkSemaphore syncObjectManager::acquireBinarySemaphore() noexcept {
-	if (this->freeSemaphores.size() > 0) {
-		return this->freeSemaphores.dequeueBack();
+void syncObjectManager::prewarm(uint32_t numBinarySemaphores, uint32_t numFences) noexcept {
+	for (uint32_t i = 0; i < numBinarySemaphores; i++) {
+		VkSemaphore s = this->createBinarySemaphore();
+		vkm::vk::debugLabel(instance->vkDevice, s, "semaphoreBinary_prewarmed");
+		this->freeSemaphores.push(s);
 	}
+	for (uint32_t i = 0; i < numFences; i++) {
+		// free fences are always signaled
+		VkFence f = this->createFence(true);
+		vkm::vk::debugLabel(instance->vkDevice, f, "fence_prewarmed");
+		this->freeFences.push(f);
+	}
+}
+
+VkSemaphore syncObjectManager::createBinarySemaphore() noexcept {
 	VkSemaphore s;
 	VkSemaphoreCreateInfo semaphoreInfo = {};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -49,17 +69,79 @@ VkSemaphore syncObjectManager::acquireBinarySemaphore() noexcept {
 		vkm::fatal(
 			vkm::std::sourceLocation::current(), "Failed to create semaphore: %s", vkm::vk::reflect::toString(ret).cStr());
 	}
+	return s;
+}
+VkSemaphore syncObjectManager::acquireBinarySemaphore() noexcept {
+	VkSemaphore s;
+	if (this->freeSemaphores.pop(&s)) {
+		return s;
+	}
+	s = this->createBinarySemaphore();
 	vkm::vk::debugLabel(instance->vkDevice, s, "semaphoreBinary_acquired");
 	return s;
 }
 void syncObjectManager::releaseBinarySemaphore(VkSemaphore s) noexcept {
-	this->freeSemaphores.pushBack(s);
 	vkm::vk::debugLabel(instance->vkDevice, s, "semaphoreBinary_released");
+	this->freeSemaphores.push(s);
 }
 
+VkFence syncObjectManager::createFence(bool signal) noexcept {
+	VkFence f;
+	VkFenceCreateInfo fenceInfo = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+	if (signal) {
+		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+	}
+	const VkResult ret = VK_PROC_DEVICE(this->instance, vkCreateFence)(this->instance->vkDevice, &fenceInfo, nullptr, &f);
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create fence: %s", vkm::vk::reflect::toString(ret).cStr());
+	}
+	return f;
+}
+void syncObjectManager::recycleFences(uint32_t maxFences) noexcept {
+	if (!this->pendingFencesMutex.tryLock()) {
+		return;
+	}
+	DEFER([&] { this->pendingFencesMutex.unlock(); });
+
+	{
+		VkFence f;
+		while (this->releasedFences.pop(&f)) {
+			this->pendingFences.pushBack(f);
+		}
+	}
+
+	for (uint32_t i = 0; i < maxFences && this->pendingFences.size() > 0; i++) {
+		const VkFence f = this->pendingFences.dequeueFront();
+		const VkResult ret = VK_PROC_DEVICE(this->instance, vkGetFenceStatus)(this->instance->vkDevice, f);
+		switch (ret) {
+			case VK_SUCCESS:
+				this->freeFences.push(f);
+				break;
+			case VK_NOT_READY:
+				this->pendingFences.pushBack(f);
+				break;
+			default:
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to get fence status: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+		}
+	}
+}
 VkFence syncObjectManager::acquireFence(bool signal) noexcept {
-	if (this->freeFences.size() > 0) {
-		VkFence f = this->freeFences.dequeueBack();
+	{
+		const uint32_t outstanding = this->outstandingFences.fetchAdd(1, vkm::std::memoryOrder::relaxed) + 1;
+		uint32_t peak = this->peakFences.load(vkm::std::memoryOrder::relaxed);
+		while (outstanding > peak && !this->peakFences.compareExchangeWeak(peak, outstanding, vkm::std::memoryOrder::relaxed,
+																		   vkm::std::memoryOrder::relaxed)) {
+		}
+	}
+
+	VkFence f;
+	bool found = this->freeFences.pop(&f);
+	if (!found) {
+		this->recycleFences(16);
+		found = this->freeFences.pop(&f);
+	}
+	if (found) {
 		if (!signal) {
 			const VkResult ret = VK_PROC_DEVICE(this->instance, vkResetFences)(this->instance->vkDevice, 1, &f);
 			if (ret != VK_SUCCESS) {
@@ -70,24 +152,13 @@ VkFence syncObjectManager::acquireFence(bool signal) noexcept {
 		return f;
 	}
 
-	VkFence f;
-	VkFenceCreateInfo fenceInfo = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
-	if (signal) {
-		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-	}
-	const VkResult ret = VK_PROC_DEVICE(this->instance, vkCreateFence)(this->instance->vkDevice, &fenceInfo, nullptr, &f);
-	if (ret != VK_SUCCESS) {
-		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create fence: %s", vkm::vk::reflect::toString(ret).cStr());
-	}
+	f = this->createFence(signal);
 	vkm::vk::debugLabel(instance->vkDevice, f, "fence_acquired");
 	return f;
 }
 void syncObjectManager::releaseFence(VkFence f) noexcept {
-	const VkResult ret = VK_PROC_DEVICE(this->instance, vkWaitForFences)(this->instance->vkDevice, 1, &f, VK_TRUE, 0);
-	if (ret != VK_SUCCESS) {
-		vkm::fatal(vkm::std::sourceLocation::current(), "Cannot release fence: %s", vkm::vk::reflect::toString(ret).cStr());
-	}
-	this->freeFences.pushBack(f);
 	vkm::vk::debugLabel(instance->vkDevice, f, "fence_released");
+	this->releasedFences.push(f);
+	this->outstandingFences.fetchSub(1, vkm::std::memoryOrder::relaxed);
 }
 }  // namespace vkm::vk::device
@@ -20,19 +20,154 @@ limitations under the License.
 #error C++ only header
 #endif
 
+#include <stdint.h>
 #include <stdio.h>
+#include <new>
 
-#include "vkm/std/vector.hpp"
+#include "vkm/std/atomic.hpp"
+#include "vkm/std/array.hpp"
+#include "vkm/std/ringbuffer.hpp"
+#include "vkm/std/thread.hpp"
 
 #include "vkm.hpp"
 
 namespace vkm::vk::device {
 struct instance;
+
+// Treiber stack of handles safe to push and pop from any number of threads without a mutex.
+// Nodes live in chunks that are never freed before the list itself, so a stale pop can always read a node
+// and the 32 bit tag packed next to the head index prevents ABA when a node is popped and pushed back in between.
+// Nodes are recycled through a second stack so steady state push/pop never allocates.
+template <typename T>
+class lockFreeList {
+   private:
+	static constexpr uint32_t nullIndex = UINT32_MAX;
+	static constexpr uint32_t firstChunkSize = 64;
+	// chunk k holds firstChunkSize << k nodes, 26 chunks covers the whole 32 bit index space
+	static constexpr uint32_t maxChunks = 26;
+
+	struct node {
+		T value;
+		vkm::std::atomic<uint32_t> next;
+	};
+
+	vkm::std::array<vkm::std::atomic<node*>, maxChunks> chunks;
+	vkm::std::atomic<uint32_t> numNodes;
+	// low 32 bits is the index of the top node, high 32 bits is a tag bumped on every successful pop
+	vkm::std::atomic<uint64_t> full = packHead(nullIndex, 0);
+	vkm::std::atomic<uint64_t> empty = packHead(nullIndex, 0);
+
+	[[nodiscard]] static constexpr uint64_t packHead(uint32_t index, uint32_t tag) noexcept {
+		return (static_cast<uint64_t>(tag) << 32) | index;
+	}
+	[[nodiscard]] static constexpr uint32_t headIndex(uint64_t head) noexcept { return static_cast<uint32_t>(head); }
+	[[nodiscard]] static constexpr uint32_t headTag(uint64_t head) noexcept { return static_cast<uint32_t>(head >> 32); }
+
+	[[nodiscard]] static constexpr uint32_t chunkOf(uint32_t index) noexcept {
+		return 31 - static_cast<uint32_t>(__builtin_clz((index / firstChunkSize) + 1));
+	}
+	[[nodiscard]] static constexpr uint32_t chunkBase(uint32_t chunk) noexcept {
+		return firstChunkSize * ((1u << chunk) - 1);
+	}
+
+	[[nodiscard]] node& at(uint32_t index) noexcept {
+		const uint32_t chunk = chunkOf(index);
+		return this->chunks[chunk].load(vkm::std::memoryOrder::acquire)[index - chunkBase(chunk)];
+	}
+
+	[[nodiscard]] uint32_t allocateNode() noexcept {
+		const uint32_t index = this->numNodes.fetchAdd(1, vkm::std::memoryOrder::relaxed);
+		const uint32_t chunk = chunkOf(index);
+		if (chunk >= maxChunks) {
+			vkm::fatal("lockFreeList out of nodes");
+		}
+		if (this->chunks[chunk].load(vkm::std::memoryOrder::acquire) == nullptr) {
+			node* fresh = new (::std::nothrow) node[firstChunkSize << chunk]();
+			if (fresh == nullptr) {
+				vkm::fatal("Failed to allocate lockFreeList nodes");
+			}
+			node* expected = nullptr;
+			if (!this->chunks[chunk].compareExchangeStrong(expected, fresh, vkm::std::memoryOrder::acqRel,
+														  vkm::std::memoryOrder::acquire)) {
+				delete[] fresh;
+			}
+		}
+		return index;
+	}
+
+	void push(vkm::std::atomic<uint64_t>& head, uint32_t index) noexcept {
+		node& n = this->at(index);
+		uint64_t old = head.load(vkm::std::memoryOrder::relaxed);
+		do {
+			n.next.store(headIndex(old), vkm::std::memoryOrder::relaxed);
+		} while (!head.compareExchangeWeak(old, packHead(index, headTag(old)), vkm::std::memoryOrder::release,
+										   vkm::std::memoryOrder::relaxed));
+	}
+	[[nodiscard]] uint32_t pop(vkm::std::atomic<uint64_t>& head) noexcept {
+		uint64_t old = head.load(vkm::std::memoryOrder::acquire);
+		while (headIndex(old) != nullIndex) {
+			const uint32_t next = this->at(headIndex(old)).next.load(vkm::std::memoryOrder::relaxed);
+			if (head.compareExchangeWeak(old, packHead(next, headTag(old) + 1), vkm::std::memoryOrder::acquire,
+										 vkm::std::memoryOrder::acquire)) {
+				return headIndex(old);
+			}
+		}
+		return nullIndex;
+	}
+
+   public:
+	lockFreeList(const lockFreeList&) = delete;
+	lockFreeList& operator=(const lockFreeList&) = delete;
+
+	lockFreeList() noexcept = default;
+	~lockFreeList() noexcept {
+		for (auto& c : this->chunks) {
+			delete[] c.load(vkm::std::memoryOrder::relaxed);
+		}
+	}
+
+	void push(T value) noexcept {
+		uint32_t index = this->pop(this->empty);
+		if (index == nullIndex) {
+			index = this->allocateNode();
+		}
+		this->at(index).value = value;
+		this->push(this->full, index);
+	}
+	// returns false if the list is empty
+	[[nodiscard]] bool pop(T* value) noexcept {
+		const uint32_t index = this->pop(this->full);
+		if (index == nullIndex) {
+			return false;
+		}
+		*value = this->at(index).value;
+		this->push(this->empty, index);
+		return true;
+	}
+};
+
+// every function may be called concurrently from any thread except clear which requires no other calls in flight
 class syncObjectManager {
    private:
 	struct instance* instance;
-	vkm::std::vector<VkSemaphore> freeSemaphores;
-	vkm::std::vector<VkFence> freeFences;
+	lockFreeList<VkSemaphore> freeSemaphores;
+	lockFreeList<VkFence> freeFences;
+	// released but possibly still in use by the gpu, releaseFence only pushes to releasedFences so it never locks.
+	// recycleFences queues them behind pendingFences, which it polls oldest first so fences that have long been
+	// signaled are not buried under newer ones, and moves the signaled ones to freeFences
+	lockFreeList<VkFence> releasedFences;
+	vkm::std::mutex pendingFencesMutex;
+	vkm::std::ringbuffer<VkFence> pendingFences;
+	// fences currently acquired and the most that have ever been acquired at once
+	vkm::std::atomic<uint32_t> outstandingFences;
+	vkm::std::atomic<uint32_t> peakFences;
+
+	VkSemaphore createBinarySemaphore() noexcept;
+	VkFence createFence(bool) noexcept;
+	// polls up to maxFences pending fences oldest first and moves the signaled ones to freeFences,
+	// the rest go to the back so repeated calls cycle through every pending fence.
+	// does nothing if another thread is already recycling
+	void recycleFences(uint32_t maxFences) noexcept;
 
    public:
 	syncObjectManager() = delete;
@@ -43,6 +178,9 @@ class syncObjectManager {
 	~syncObjectManager() noexcept = default;
 
 	void clear();
+	// creates objects up front and places them in the free lists so later acquires don't have to
+	void prewarm(uint32_t numBinarySemaphores, uint32_t numFences) noexcept;
+	[[nodiscard]] uint32_t getPeakFences() const noexcept { return this->peakFences.load(vkm::std::memoryOrder::relaxed); }
 
 	VkSemaphore acquireBinarySemaphore() noexcept;
 	void releaseBinarySemaphore(VkSemaphore) noexcept;
@@ -0,0 +1,152 @@
+/*
+Copyright 2026 The goARRG Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "device/sync/waiter.hpp"
+
+#include <algorithm>
+
+#include "vkm/std/algorithm.hpp"
+#include "vkm/std/stdlib.hpp"
+#include "vkm/std/string.hpp"
+
+#include "vkm.hpp"
+#include "vklog.hpp"
+#include "reflect_const.hpp"
+#include "device/device.hpp"
+
+namespace vkm::vk::device {
+timelineWaiter::timelineWaiter(struct instance* instance) noexcept : instance(instance) {}
+
+void timelineWaiter::wake() noexcept {
+	this->wakeValue++;
+	vkm_semaphore_timeline_signal(this->instance->handle(), this->wakeSemaphore, this->wakeValue);
+}
+
+void timelineWaiter::run(void* data) noexcept {
+	auto* self = static_cast<timelineWaiter*>(data);
+	vkm::std::vector<VkSemaphore> semaphores;
+	vkm::std::vector<uint64_t> values;
+	vkm::std::vector<waiter> ready;
+
+	self->mutex.lock();
+	while (!self->stop) {
+		// one entry per semaphore waiting on the lowest value anyone needs
+		semaphores.resize(0);
+		values.resize(0);
+		semaphores.pushBack(self->wakeSemaphore);
+		values.pushBack(self->wakeValue + 1);
+		for (const auto& w : self->waiters) {
+			const size_t i =
+				vkm::std::linearSearch(semaphores.size(), [&](size_t i) -> bool { return semaphores[i] == w.semaphore; });
+			if (i == semaphores.size()) {
+				semaphores.pushBack(w.semaphore);
+				values.pushBack(w.value);
+			} else {
+				values[i] = vkm::std::min(values[i], w.value);
+			}
+		}
+		self->mutex.unlock();
+
+		{
+			const VkSemaphoreWaitInfo waitInfo = {
+				.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+				.flags = VK_SEMAPHORE_WAIT_ANY_BIT,
+				.semaphoreCount = static_cast<uint32_t>(semaphores.size()),
+				.pSemaphores = semaphores.get(),
+				.pValues = values.get(),
+			};
+			const VkResult ret =
+				VK_PROC_DEVICE(self->instance, vkWaitSemaphores)(self->instance->vkDevice, &waitInfo, UINT64_MAX);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed waiting on semaphores: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+		}
+		// values now holds the current value of each semaphore
+		for (size_t i = 1; i < semaphores.size(); i++) {
+			values[i] = vkm_semaphore_timeline_getValue(self->instance->handle(), semaphores[i]);
+		}
+
+		self->mutex.lock();
+		{
+			size_t n = 0;
+			for (const auto& w : self->waiters) {
+				const size_t i =
+					vkm::std::linearSearch(semaphores.size(), [&](size_t i) -> bool { return semaphores[i] == w.semaphore; });
+				// waiters added while waiting are not in semaphores yet
+				if (i != 0 && i != semaphores.size() && values[i] >= w.value) {
+					ready.pushBack(w);
+				} else {
+					self->waiters[n++] = w;
+				}
+			}
+			self->waiters.resize(n);
+		}
+		if (ready.size() == 0) {
+			continue;
+		}
+		self->mutex.unlock();
+
+		::std::sort(ready.begin(), ready.end(), [](const waiter& a, const waiter& b) -> bool {
+			return a.value != b.value ? a.value < b.value : a.order < b.order;
+		});
+		for (const auto& w : ready) {
+			w.fn(w.userdata, w.semaphore, w.value);
+		}
+		ready.resize(0);
+
+		self->mutex.lock();
+	}
+	self->mutex.unlock();
+}
+
+void timelineWaiter::onReached(VkSemaphore semaphore, uint64_t value, vkm_semaphore_timeline_callback fn,
+							   void* userdata) noexcept {
+	this->mutex.lock();
+	if (!this->thread.joinable()) {
+		vkm_createTimelineSemaphore(this->instance->handle(), vkm::std::string<char>("timelineWaiter_wake").vkm_string(), 0,
+									&this->wakeSemaphore);
+		this->wakeValue = 0;
+		this->stop = false;
+		this->thread.start(timelineWaiter::run, this);
+	}
+	this->waiters.pushBack(waiter{
+		.semaphore = semaphore,
+		.value = value,
+		.order = this->numRegistered++,
+		.fn = fn,
+		.userdata = userdata,
+	});
+	this->wake();
+	this->mutex.unlock();
+}
+
+void timelineWaiter::shutdown() noexcept {
+	this->mutex.lock();
+	if (!this->thread.joinable()) {
+		this->mutex.unlock();
+		return;
+	}
+	this->stop = true;
+	this->wake();
+	this->mutex.unlock();
+
+	this->thread.join();
+	vkm_destroyTimelineSemaphore(this->instance->handle(), this->wakeSemaphore);
+	this->wakeSemaphore = VK_NULL_HANDLE;
+	this->waiters.resize(0);
+}
+}  // namespace vkm::vk::device
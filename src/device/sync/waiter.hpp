@@ -0,0 +1,73 @@
+/*
+Copyright 2026 The goARRG Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#ifndef __cplusplus
+#error C++ only header
+#endif
+
+#include <stdint.h>
+
+#include "vkm/std/vector.hpp"
+#include "vkm/std/thread.hpp"
+
+#include "vkm/vkm.h"
+#include "vkm.hpp"
+
+namespace vkm::vk::device {
+struct instance;
+
+// runs callbacks once timeline semaphores reach a value, every outstanding wait is batched into a single
+// wait-any vkWaitSemaphores on a thread started by the first onReached
+class timelineWaiter {
+   private:
+	struct waiter {
+		VkSemaphore semaphore;
+		uint64_t value;
+		// registration order, breaks ties between waiters that become ready with the same value
+		uint64_t order;
+		vkm_semaphore_timeline_callback fn;
+		void* userdata;
+	};
+
+	struct instance* instance;
+	vkm::std::mutex mutex;
+	vkm::std::vector<waiter> waiters;
+	uint64_t numRegistered = 0;
+	bool stop = false;
+	// always part of the batched wait so the thread can be woken when waiters are added or on shutdown
+	VkSemaphore wakeSemaphore = VK_NULL_HANDLE;
+	uint64_t wakeValue = 0;
+	vkm::std::thread thread;
+
+	static void run(void*) noexcept;
+	// mutex must be held
+	void wake() noexcept;
+
+   public:
+	timelineWaiter() = delete;
+	timelineWaiter(const timelineWaiter&) = delete;
+	timelineWaiter& operator=(const timelineWaiter&) = delete;
+
+	timelineWaiter(struct instance*) noexcept;
+	~timelineWaiter() noexcept = default;
+
+	void onReached(VkSemaphore, uint64_t, vkm_semaphore_timeline_callback, void*) noexcept;
+	// joins the thread, callbacks that have not been reached are dropped
+	void shutdown() noexcept;
+};
+}  // namespace vkm::vk::device
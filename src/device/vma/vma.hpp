@@ -21,6 +21,11 @@ limitations under the License.
 #endif
 
 #include <stdint.h>
+#include <new>
+
+#include "vkm/std/vector.hpp"
+#include "vkm/std/thread.hpp"
+#include "vkm/std/utility.hpp"
 
 // avoids including vulkan.h and thus windows.h
 #include "vkm/vkm.h"  // IWYU pragma: keep
@@ -52,5 +57,50 @@ struct vma {
 	VmaAllocator allocator;
 	uint32_t noBARMemoryTypeBits;
 	uint32_t barMemoryTypeBits;
+	// device buffers and images are allocated from these, one per memory type, so defragmentation which only
+	// runs over them never sees an allocation it can't move
+	vkm::std::mutex movablePoolsMutex;
+	vkm::std::vector<vkm::std::pair<uint32_t, VmaPool>> movablePools;
+};
+
+// pUserData of allocations from vkm_createDeviceBuffer and vkm_createImage,
+// keeps what defragmentation needs to recreate the resource in its new place
+struct movableResource {
+	VkObjectType type;
+	// pNext is dropped, pQueueFamilyIndices points into queueFamilyIndices
+	VkBufferCreateInfo bufferInfo;
+	VkImageCreateInfo imageInfo;
+	vkm::std::vector<uint32_t> queueFamilyIndices;
+	// current handle, replaced when moved
+	VkBuffer vkBuffer;
+	VkImage vkImage;
+
+	[[nodiscard]] static movableResource* fromBufferInfo(const VkBufferCreateInfo& info) noexcept {
+		auto* m = new (::std::nothrow) movableResource();
+		m->type = VK_OBJECT_TYPE_BUFFER;
+		m->bufferInfo = info;
+		m->bufferInfo.pNext = nullptr;
+		if (info.sharingMode == VK_SHARING_MODE_CONCURRENT) {
+			m->queueFamilyIndices.pushBack(info.queueFamilyIndexCount, info.pQueueFamilyIndices);
+		}
+		m->bufferInfo.pQueueFamilyIndices = m->queueFamilyIndices.get();
+		return m;
+	}
+	[[nodiscard]] static movableResource* fromImageInfo(const VkImageCreateInfo& info) noexcept {
+		auto* m = new (::std::nothrow) movableResource();
+		m->type = VK_OBJECT_TYPE_IMAGE;
+		m->imageInfo = info;
+		m->imageInfo.pNext = nullptr;
+		if (info.sharingMode == VK_SHARING_MODE_CONCURRENT) {
+			m->queueFamilyIndices.pushBack(info.queueFamilyIndexCount, info.pQueueFamilyIndices);
+		}
+		m->imageInfo.pQueueFamilyIndices = m->queueFamilyIndices.get();
+		return m;
+	}
+	[[nodiscard]] static movableResource* fromAllocation(VmaAllocator allocator, VmaAllocation allocation) noexcept {
+		VmaAllocationInfo info;
+		vmaGetAllocationInfo(allocator, allocation, &info);
+		return static_cast<movableResource*>(info.pUserData);
+	}
 };
 }  // namespace vkm::vk::device
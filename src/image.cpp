@@ -17,8 +17,11 @@ limitations under the License.
 #include "vkm/vkm.h"  // IWYU pragma: associated
 
 #include <stddef.h>
+#include <new>
+#include <algorithm>
 
 #include "vkm/std/stdlib.hpp"
+#include "vkm/std/vector.hpp"
 #include "vkm/std/string.hpp"
 #include "vkm/std/utility.hpp"
 
@@ -56,13 +59,39 @@ VKM_FN VkBool32 vkm_getFormatHasImageUsageFlags(vkm_device instanceHandle, VkFor
 	return VK_FALSE;
 }
 VKM_FN void vkm_createImage(vkm_device instanceHandle, vkm_string name, VkImageCreateInfo info, vkm_image* t) {
+	vkm_createImage2(instanceHandle, name, info, 0.5f, t);
+}
+VKM_FN void vkm_createImage2(vkm_device instanceHandle, vkm_string name, VkImageCreateInfo info, float priority,
+							 vkm_image* t) {
 	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	if (priority < 0.0f || priority > 1.0f) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Image priority %f is outside of [0, 1]",
+				   static_cast<double>(priority));
+	}
 
 	{
+		auto* movable = ::vkm::vk::device::movableResource::fromImageInfo(info);
+
 		VmaAllocationCreateInfo allocCreateInfo = {};
 		allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 		allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 		allocCreateInfo.memoryTypeBits = instance->vma.noBARMemoryTypeBits;
+		allocCreateInfo.pUserData = movable;
+		allocCreateInfo.priority = priority;
+		// see vkm_createDeviceBuffer2
+		if (instance->optionalFeatures.hasEXTMemoryPriority && priority != 0.5f) {
+			allocCreateInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+		}
+		{
+			uint32_t memoryTypeIndex;
+			const VkResult ret = vmaFindMemoryTypeIndexForImageInfo(instance->vma.allocator, &info, &allocCreateInfo,
+																	&memoryTypeIndex);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to find memory type for image: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+			allocCreateInfo.pool = ::vkm::vk::device::movablePool(instance, memoryTypeIndex);
+		}
 
 		const VkResult ret = vmaCreateImage(instance->vma.allocator, &info, &allocCreateInfo, &t->vkImage,
 											reinterpret_cast<VmaAllocation*>(&t->allocation), nullptr);
@@ -70,6 +99,7 @@ VKM_FN void vkm_createImage(vkm_device instanceHandle, vkm_string name, VkImageC
 			vkm::fatal(
 				vkm::std::sourceLocation::current(), "Failed to create image: %s", vkm::vk::reflect::toString(ret).cStr());
 		}
+		movable->vkImage = t->vkImage;
 	}
 	vkm::std::debugRun([=]() {
 		vkm::std::stringbuilder builder;
@@ -82,8 +112,250 @@ VKM_FN void vkm_createImage(vkm_device instanceHandle, vkm_string name, VkImageC
 }
 VKM_FN void vkm_destroyImage(vkm_device instanceHandle, vkm_image t) {
 	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	if (::vkm::vk::device::deferDefragDestroy(instance, reinterpret_cast<VmaAllocation>(t.allocation))) {
+		return;
+	}
+	delete ::vkm::vk::device::movableResource::fromAllocation(instance->vma.allocator,
+															  reinterpret_cast<VmaAllocation>(t.allocation));
 	vmaDestroyImage(instance->vma.allocator, t.vkImage, reinterpret_cast<VmaAllocation>(t.allocation));
 }
+VKM_FN void vkm_createImages(vkm_device instanceHandle, uint32_t count, const vkm_string* names,
+							 const VkImageCreateInfo* infos, vkm_image* images, VkResult* results) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+
+	vkm::std::vector<VkMemoryRequirements> requirements(count);
+	for (uint32_t i = 0; i < count; i++) {
+		const VkDeviceImageMemoryRequirements info = {
+			.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+			.pCreateInfo = &infos[i],
+		};
+		VkMemoryRequirements2 imageRequirements = {.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+		VK_PROC_DEVICE(instance, vkGetDeviceImageMemoryRequirements)(instance->vkDevice, &info, &imageRequirements);
+		requirements[i] = imageRequirements.memoryRequirements;
+	}
+
+	VmaAllocationCreateInfo allocCreateInfo = {};
+	allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+	allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	allocCreateInfo.memoryTypeBits = instance->vma.noBARMemoryTypeBits;
+
+	vkm::std::vector<VmaAllocation> allocations(count);
+	vkm::vk::device::allocateMemoryBatch(instance, allocCreateInfo, true, count, requirements.get(), allocations.get(),
+										 results);
+
+	for (uint32_t i = 0; i < count; i++) {
+		images[i] = vkm_image{};
+		if (results[i] != VK_SUCCESS) {
+			continue;
+		}
+		VkImage vkImage;
+		results[i] = VK_PROC_DEVICE(instance, vkCreateImage)(instance->vkDevice, &infos[i], nullptr, &vkImage);
+		if (results[i] == VK_SUCCESS) {
+			results[i] = vmaBindImageMemory(instance->vma.allocator, allocations[i], vkImage);
+			if (results[i] != VK_SUCCESS) {
+				VK_PROC_DEVICE(instance, vkDestroyImage)(instance->vkDevice, vkImage, nullptr);
+			}
+		}
+		if (results[i] != VK_SUCCESS) {
+			vmaFreeMemory(instance->vma.allocator, allocations[i]);
+			continue;
+		}
+
+		auto* movable = ::vkm::vk::device::movableResource::fromImageInfo(infos[i]);
+		movable->vkImage = vkImage;
+		vmaSetAllocationUserData(instance->vma.allocator, allocations[i], movable);
+		images[i] = vkm_image{
+			.allocation = reinterpret_cast<vkm_allocation>(allocations[i]),
+			.vkImage = vkImage,
+		};
+
+		vkm::std::debugRun([&]() {
+			vkm::std::stringbuilder builder;
+			if (names != nullptr) {
+				builder.write(names[i]);
+			}
+			builder.write("_image");
+			vkm::vk::debugLabel(instance->vkDevice, vkImage, builder.cStr());
+
+			builder.write("_allocation");
+			vmaSetAllocationName(instance->vma.allocator, allocations[i], builder.cStr());
+		});
+	}
+}
+VKM_FN void vkm_destroyImages(vkm_device instanceHandle, uint32_t count, const vkm_image* images) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	if (count == 0) {
+		return;
+	}
+
+	vkm::std::vector<VmaAllocation> allocations(count);
+	for (uint32_t i = 0; i < count; i++) {
+		allocations[i] = reinterpret_cast<VmaAllocation>(images[i].allocation);
+		if (allocations[i] != nullptr && ::vkm::vk::device::deferDefragDestroy(instance, allocations[i])) {
+			allocations[i] = nullptr;
+		}
+		if (allocations[i] != nullptr) {
+			delete ::vkm::vk::device::movableResource::fromAllocation(instance->vma.allocator, allocations[i]);
+			VK_PROC_DEVICE(instance, vkDestroyImage)(instance->vkDevice, images[i].vkImage, nullptr);
+		}
+	}
+	vmaFreeMemoryPages(instance->vma.allocator, count, allocations.get());
+}
+VKM_FN void vkm_createTransientImage(vkm_device instanceHandle, vkm_string name, VkImageCreateInfo info, vkm_image* t) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+
+	constexpr VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+												  | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+												  | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+	if ((info.usage & ~(attachmentUsage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)) != 0) {
+		vkm::fatal("Transient images may only be used as attachments");
+	}
+	info.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+	{
+		VmaAllocationCreateInfo allocCreateInfo = {};
+		allocCreateInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+		allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+		allocCreateInfo.memoryTypeBits = instance->vma.noBARMemoryTypeBits;
+
+		VkResult ret = vmaCreateImage(instance->vma.allocator, &info, &allocCreateInfo, &t->vkImage,
+									  reinterpret_cast<VmaAllocation*>(&t->allocation), nullptr);
+		if (ret == VK_ERROR_FEATURE_NOT_PRESENT) {
+			// no lazily allocated memory type, usually desktop GPUs
+			allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+			allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+			ret = vmaCreateImage(instance->vma.allocator, &info, &allocCreateInfo, &t->vkImage,
+								 reinterpret_cast<VmaAllocation*>(&t->allocation), nullptr);
+		}
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(
+				vkm::std::sourceLocation::current(), "Failed to create image: %s", vkm::vk::reflect::toString(ret).cStr());
+		}
+	}
+	vkm::std::debugRun([=]() {
+		vkm::std::stringbuilder builder;
+		builder.write(name).write("_transientImage");
+		vkm::vk::debugLabel(instance->vkDevice, t->vkImage, builder.cStr());
+
+		builder.write("_allocation");
+		vmaSetAllocationName(instance->vma.allocator, reinterpret_cast<VmaAllocation>(t->allocation), builder.cStr());
+	});
+}
+VKM_FN void vkm_createAliasedImages(vkm_device instanceHandle, vkm_string name, uint32_t count,
+									const vkm_aliasedImageInfo* infos, vkm_image* images) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	if (count == 0) {
+		return;
+	}
+
+	struct placement {
+		uint32_t index;
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+	vkm::std::vector<placement> placements(count);
+	VkMemoryRequirements requirements = {
+		.size = 0,
+		.alignment = 1,
+		.memoryTypeBits = instance->vma.noBARMemoryTypeBits,
+	};
+	for (uint32_t i = 0; i < count; i++) {
+		const VkDeviceImageMemoryRequirements info = {
+			.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+			.pCreateInfo = &infos[i].info,
+		};
+		VkMemoryRequirements2 imageRequirements = {.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+		VK_PROC_DEVICE(instance, vkGetDeviceImageMemoryRequirements)(instance->vkDevice, &info, &imageRequirements);
+
+		placements[i] = placement{
+			.index = i,
+			.offset = imageRequirements.memoryRequirements.alignment,
+			.size = imageRequirements.memoryRequirements.size,
+		};
+		requirements.alignment = vkm::std::max(requirements.alignment, imageRequirements.memoryRequirements.alignment);
+		requirements.memoryTypeBits &= imageRequirements.memoryRequirements.memoryTypeBits;
+	}
+	if (requirements.memoryTypeBits == 0) {
+		vkm::fatal("Aliased images have no device local memory type in common");
+	}
+
+	// greedy interval packing, largest first, each image goes to the lowest offset that does not overlap
+	// an already placed image it is alive at the same time as. offset holds the alignment until placed
+	::std::sort(placements.begin(), placements.end(),
+				[](const placement& a, const placement& b) -> bool { return a.size > b.size; });
+	const auto overlaps = [&](const vkm_aliasedImageInfo& a, const vkm_aliasedImageInfo& b) -> bool {
+		return a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+	};
+	for (size_t i = 0; i < placements.size(); i++) {
+		auto& p = placements[i];
+		const VkDeviceSize alignment = p.offset;
+		VkDeviceSize offset = 0;
+		for (bool moved = true; moved;) {
+			moved = false;
+			for (size_t j = 0; j < i; j++) {
+				const auto& q = placements[j];
+				if (!overlaps(infos[p.index], infos[q.index]) || offset >= q.offset + q.size || q.offset >= offset + p.size) {
+					continue;
+				}
+				offset = ((q.offset + q.size + alignment - 1) / alignment) * alignment;
+				moved = true;
+			}
+		}
+		p.offset = offset;
+		requirements.size = vkm::std::max(requirements.size, offset + p.size);
+	}
+
+	VmaAllocation allocation;
+	{
+		// no VMA_MEMORY_USAGE_AUTO*, vmaAllocateMemory does not know about the images
+		VmaAllocationCreateInfo allocCreateInfo = {};
+		allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		allocCreateInfo.memoryTypeBits = requirements.memoryTypeBits;
+
+		const VkResult ret = vmaAllocateMemory(instance->vma.allocator, &requirements, &allocCreateInfo, &allocation, nullptr);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to allocate aliased image memory: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+	}
+	for (const auto& p : placements) {
+		VkImage vkImage;
+		VkResult ret = VK_PROC_DEVICE(instance, vkCreateImage)(instance->vkDevice, &infos[p.index].info, nullptr, &vkImage);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(
+				vkm::std::sourceLocation::current(), "Failed to create image: %s", vkm::vk::reflect::toString(ret).cStr());
+		}
+		ret = vmaBindImageMemory2(instance->vma.allocator, allocation, p.offset, vkImage, nullptr);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(
+				vkm::std::sourceLocation::current(), "Failed to bind image: %s", vkm::vk::reflect::toString(ret).cStr());
+		}
+		images[p.index] = vkm_image{
+			.allocation = reinterpret_cast<vkm_allocation>(allocation),
+			.vkImage = vkImage,
+		};
+		vkm::std::debugRun([&]() {
+			vkm::std::stringbuilder builder;
+			builder.write(name).write("_aliasedImage_") << p.index;
+			vkm::vk::debugLabel(instance->vkDevice, vkImage, builder.cStr());
+		});
+	}
+	vkm::std::debugRun([&]() {
+		vkm::std::stringbuilder builder;
+		builder.write(name).write("_aliasedImages_allocation");
+		vmaSetAllocationName(instance->vma.allocator, allocation, builder.cStr());
+	});
+}
+VKM_FN void vkm_destroyAliasedImages(vkm_device instanceHandle, uint32_t count, const vkm_image* images) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	if (count == 0) {
+		return;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		VK_PROC_DEVICE(instance, vkDestroyImage)(instance->vkDevice, images[i].vkImage, nullptr);
+	}
+	vmaFreeMemory(instance->vma.allocator, reinterpret_cast<VmaAllocation>(images[0].allocation));
+}
 VKM_FN void vkm_createImageView(vkm_device instanceHandle, vkm_string name, VkImageViewCreateInfo info, VkImageView* view) {
 	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
 
@@ -287,6 +287,58 @@ void initializer::checkOptionals(vkm_deviceInitInfo& info) noexcept {
 			}
 		}
 	}
+	{
+		auto features12 = VkPhysicalDeviceVulkan12Features{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+		};
+		this->enabledFeatureChain.extract(reinterpret_cast<vkm::vk::reflect::vkStructureChain*>(&features12));
+		if (features12.hostQueryReset == VK_TRUE) {
+			info.optionalFeatures.hostQueryReset = VK_TRUE;
+			vkm::vPrintf("Optional feature %s: Enabled", "hostQueryReset");
+		}
+	}
+	{
+		auto priorityFeatures = VkPhysicalDeviceMemoryPriorityFeaturesEXT{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT,
+		};
+		this->enabledFeatureChain.extract(reinterpret_cast<vkm::vk::reflect::vkStructureChain*>(&priorityFeatures));
+		if (priorityFeatures.memoryPriority == VK_TRUE) {
+			info.optionalFeatures.extMemoryPriority = VK_TRUE;
+			vkm::vPrintf("Optional feature %s: Enabled", "extMemoryPriority");
+		}
+	}
+	{
+		auto pageableFeatures = VkPhysicalDevicePageableDeviceLocalMemoryFeaturesEXT{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PAGEABLE_DEVICE_LOCAL_MEMORY_FEATURES_EXT,
+		};
+		this->enabledFeatureChain.extract(reinterpret_cast<vkm::vk::reflect::vkStructureChain*>(&pageableFeatures));
+		// VK_EXT_pageable_device_local_memory requires VK_EXT_memory_priority
+		if (pageableFeatures.pageableDeviceLocalMemory == VK_TRUE && info.optionalFeatures.extMemoryPriority == VK_TRUE) {
+			info.optionalFeatures.extPageableDeviceLocalMemory = VK_TRUE;
+			vkm::vPrintf("Optional feature %s: Enabled", "extPageableDeviceLocalMemory");
+		}
+	}
+	{
+		auto features10 = VkPhysicalDeviceFeatures2{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		};
+		this->enabledFeatureChain.extract(reinterpret_cast<vkm::vk::reflect::vkStructureChain*>(&features10));
+		vkm::std::array featureChecks = {
+			vkm::std::triple("sparseBinding", &features10.features.sparseBinding, &info.optionalFeatures.sparseBinding),
+			vkm::std::triple("sparseResidencyBuffer", &features10.features.sparseResidencyBuffer,
+							 &info.optionalFeatures.sparseResidencyBuffer),
+			vkm::std::triple("sparseResidencyImage2D", &features10.features.sparseResidencyImage2D,
+							 &info.optionalFeatures.sparseResidencyImage2D),
+			vkm::std::triple("sparseResidencyImage3D", &features10.features.sparseResidencyImage3D,
+							 &info.optionalFeatures.sparseResidencyImage3D),
+		};
+		for (auto& check : featureChecks) {
+			if (*check.second == VK_TRUE) {
+				*check.third = VK_TRUE;
+				vkm::vPrintf("Optional feature %s: Enabled", check.first);
+			}
+		}
+	}
 }
 }  // namespace vkm::vk::initializer
 
@@ -324,6 +376,27 @@ VKM_FN void vkm_createInitializer(vkm_initializerCreateInfo info, vkm_initialize
 		};
 		vkm_initializer_findFeature(*initializerHandle, VK_TRUE, &features10);
 	}
+	{
+		// used by vkm_context timestamps to reset query pools from the host
+		auto features12 = VkPhysicalDeviceVulkan12Features{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+			.hostQueryReset = VK_TRUE,
+		};
+		vkm_initializer_findFeature(*initializerHandle, VK_FALSE, &features12);
+	}
+	{
+		// lets the driver keep high priority allocations resident under memory pressure
+		auto pageableFeatures = VkPhysicalDevicePageableDeviceLocalMemoryFeaturesEXT{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PAGEABLE_DEVICE_LOCAL_MEMORY_FEATURES_EXT,
+			.pageableDeviceLocalMemory = VK_TRUE,
+		};
+		auto priorityFeatures = VkPhysicalDeviceMemoryPriorityFeaturesEXT{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT,
+			.pNext = &pageableFeatures,
+			.memoryPriority = VK_TRUE,
+		};
+		vkm_initializer_findFeature(*initializerHandle, VK_FALSE, &priorityFeatures);
+	}
 }
 VKM_FN void vkm_destroyInitializer(vkm_initializer initializerHandle) {
 	auto* initializer = vkm::vk::initializer::initializer::fromHandle(initializerHandle);
@@ -502,6 +575,29 @@ VKM_FN void vkm_initializer_findTransferQueue(vkm_initializer initializerHandle,
 		initializer->transferQueueRequirements.createInfo.priorities.resize(info.max, 1.0f);
 	}
 }
+VKM_FN void vkm_initializer_findSparseQueue(vkm_initializer initializerHandle) {
+	auto* initializer = vkm::vk::initializer::initializer::fromHandle(initializerHandle);
+	initializer->sparseQueueRequired = true;
+	{
+		auto features10 = VkPhysicalDeviceFeatures2{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.features = {.sparseBinding = VK_TRUE},
+		};
+		vkm_initializer_findFeature(initializerHandle, VK_TRUE, &features10);
+	}
+	{
+		auto features10 = VkPhysicalDeviceFeatures2{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.features =
+				{
+					.sparseResidencyBuffer = VK_TRUE,
+					.sparseResidencyImage2D = VK_TRUE,
+					.sparseResidencyImage3D = VK_TRUE,
+				},
+		};
+		vkm_initializer_findFeature(initializerHandle, VK_FALSE, &features10);
+	}
+}
 
 VKM_FN VkResult vkm_initializer_getInstanceExtensionList(vkm_initializer initializerHandle, size_t* sz, const char** out) {
 	auto* initializer = vkm::vk::initializer::initializer::fromHandle(initializerHandle);
@@ -643,6 +739,12 @@ VKM_FN VkResult vkm_initializer_createDevice(vkm_initializer initializerHandle,
 			labelQueue(initializer->graphicsQueueRequirements, "graphics");
 			labelQueue(initializer->computeQueueRequirements, "compute");
 			labelQueue(initializer->transferQueueRequirements, "transfer");
+			if (initializer->sparseQueueRequirements != nullptr) {
+				const auto& createInfo = initializer->sparseQueueRequirements->createInfo;
+				VkQueue vkQueue;
+				VKM_DEVICE_VKFN(instance, vkGetDeviceQueue)(info.vkDevice, createInfo.family, createInfo.count, &vkQueue);
+				vkm::vk::debugLabel(info.vkDevice, vkQueue, "queue_sparse");
+			}
 		});
 		return VK_SUCCESS;
 	}
@@ -707,6 +809,17 @@ VKM_FN void vkm_initializer_getTransferQueueInfo(vkm_initializer initializerHand
 		*info = {};
 	}
 }
+VKM_FN void vkm_initializer_getSparseQueueInfo(vkm_initializer initializerHandle, vkm_initializer_sparseQueueInfo* info) {
+	auto* initializer = vkm::vk::initializer::initializer::fromHandle(initializerHandle);
+	if (initializer->sparseQueueRequirements != nullptr) {
+		*info = vkm_initializer_sparseQueueInfo{
+			.family = initializer->sparseQueueRequirements->createInfo.family,
+			.index = initializer->sparseQueueRequirements->createInfo.count,
+		};
+	} else {
+		*info = {};
+	}
+}
 VKM_FN void vkm_initializer_getRejectReasons(vkm_initializer initializerHandle, size_t* count, vkm_initializer_rejectReason* ptr) {
 	auto* initializer = vkm::vk::initializer::initializer::fromHandle(initializerHandle);
 	if (ptr == nullptr) {
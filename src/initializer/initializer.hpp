@@ -206,6 +206,12 @@ class initializer {
 	queueRequirements graphicsQueueRequirements = {};
 	queueRequirements computeQueueRequirements = {};
 	queueRequirements transferQueueRequirements = {};
+	// the sparse queue is an extra queue created after those of one of the families above that supports
+	// VK_QUEUE_SPARSE_BINDING_BIT, its index is that family's createInfo.count
+	bool sparseQueueRequired = false;
+	const queueRequirements* sparseQueueRequirements = nullptr;
+	// the family's priorities followed by the sparse queue's
+	vkm::std::vector<float> sparseQueuePriorities;
 
 	vkm::std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 
@@ -242,6 +248,7 @@ class initializer {
 	friend VKM_FN void ::vkm_initializer_findGraphicsQueue(vkm_initializer, vkm_initializer_queueCreateInfo);
 	friend VKM_FN void ::vkm_initializer_findComputeQueue(vkm_initializer, vkm_initializer_queueCreateInfo);
 	friend VKM_FN void ::vkm_initializer_findTransferQueue(vkm_initializer, vkm_initializer_queueCreateInfo);
+	friend VKM_FN void ::vkm_initializer_findSparseQueue(vkm_initializer);
 
 	friend VKM_FN auto ::vkm_initializer_getInstanceExtensionList(vkm_initializer, size_t*, const char**) -> VkResult;
 	friend VKM_FN auto ::vkm_initializer_createInstance(vkm_initializer, VkInstance*) -> VkResult;
@@ -252,6 +259,7 @@ class initializer {
 	friend VKM_FN void ::vkm_initializer_getGraphicsQueueInfo(vkm_initializer, vkm_initializer_queueInfo*);
 	friend VKM_FN void ::vkm_initializer_getComputeQueueInfo(vkm_initializer, vkm_initializer_queueInfo*);
 	friend VKM_FN void ::vkm_initializer_getTransferQueueInfo(vkm_initializer, vkm_initializer_queueInfo*);
+	friend VKM_FN void ::vkm_initializer_getSparseQueueInfo(vkm_initializer, vkm_initializer_sparseQueueInfo*);
 	friend VKM_FN void ::vkm_initializer_getRejectReasons(vkm_initializer, size_t*, vkm_initializer_rejectReason*);
 	// NOLINTEND(readability-identifier-naming)
 
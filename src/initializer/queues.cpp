@@ -17,6 +17,7 @@ limitations under the License.
 #include <stddef.h>
 #include <stdint.h>
 
+#include "vkm/std/array.hpp"
 #include "vkm/std/vector.hpp"
 #include "vkm/std/utility.hpp"
 
@@ -55,6 +56,7 @@ limitations under the License.
 	(vkPhysicalDevice, &haveQueueFamilies, queueFamilies.get());
 
 	queueCreateInfos.resize(0);
+	sparseQueueRequirements = nullptr;
 
 	auto findQueue = [&](VkQueueFlags wantFlags, VkQueueFlags dontWantFlags, queueRequirements& requirements) -> bool {
 		requirements.createInfo.count = 0;
@@ -99,6 +101,39 @@ limitations under the License.
 			"Failed to find transfer queue family with at least [%d] queues", this->transferQueueRequirements.min);
 		return false;
 	}
+	if (this->sparseQueueRequired) {
+		// prefer the least busy family, binds would otherwise be serialized with rendering
+		const vkm::std::array candidates = {
+			&this->transferQueueRequirements,
+			&this->computeQueueRequirements,
+			&this->graphicsQueueRequirements,
+		};
+		for (const auto* requirements : candidates) {
+			const uint32_t family = requirements->createInfo.family;
+			if (requirements->createInfo.count > 0
+				&& (queueFamilies[family].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT) != 0
+				&& queueFamilies[family].queueCount > requirements->createInfo.count) {
+				this->sparseQueueRequirements = requirements;
+				break;
+			}
+		}
+		if (this->sparseQueueRequirements == nullptr) {
+			this->appendRejectReason("Failed to find a requested queue family with sparse binding support and a spare queue");
+			return false;
+		}
+
+		// queues need external synchronization, so the binder gets one of its own after the family's queues
+		const auto& createInfo = this->sparseQueueRequirements->createInfo;
+		this->sparseQueuePriorities.resize(0);
+		this->sparseQueuePriorities.pushBack(createInfo.count, createInfo.priorities.get());
+		this->sparseQueuePriorities.pushBack(1.0f);
+		for (auto& info : this->queueCreateInfos) {
+			if (info.queueFamilyIndex == createInfo.family) {
+				info.queueCount = createInfo.count + 1;
+				info.pQueuePriorities = this->sparseQueuePriorities.get();
+			}
+		}
+	}
 
 	bool ok = true;
 	for (VkSurfaceKHR s : targetSurfaces) {
@@ -20,7 +20,6 @@ limitations under the License.
 #include <stdint.h>
 
 #include "vkm/std/stdlib.hpp"
-#include "vkm/std/array.hpp"
 #include "vkm/std/time.hpp"
 #include "vkm/std/string.hpp"
 
@@ -59,6 +58,20 @@ VKM_FN void vkm_destroyTimelineSemaphore(vkm_device instanceHandle, VkSemaphore
 	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
 	VK_PROC_DEVICE(instance, vkDestroySemaphore)(instance->vkDevice, semaphore, nullptr);
 }
+VKM_FN VkBool32 vkm_completionToken_poll(vkm_device instanceHandle, vkm_completionToken token) {
+	return vkm_semaphore_timeline_getValue(instanceHandle, token.vkSemaphore) >= token.value ? VK_TRUE : VK_FALSE;
+}
+VKM_FN VkResult vkm_completionToken_wait(vkm_device instanceHandle, vkm_completionToken token, uint64_t timeout) {
+	vkm::std::debugRun([&]() {
+		auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+		if (!::vkm::vk::device::timelineSubmitted(instance, token.vkSemaphore, token.value)) {
+			vkm::fatal(vkm::std::sourceLocation::current(),
+					   "Waiting on token value %llu that has not been submitted, flush the context first",
+					   static_cast<unsigned long long>(token.value));
+		}
+	});
+	return vkm_semaphore_timeline_waitMany(instanceHandle, 1, &token.vkSemaphore, &token.value, 0, timeout);
+}
 VKM_FN void vkm_semaphore_timeline_signal(vkm_device instanceHandle, VkSemaphore semaphore, uint64_t value) {
 	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
 
@@ -76,25 +89,27 @@ VKM_FN void vkm_semaphore_timeline_signal(vkm_device instanceHandle, VkSemaphore
 VKM_FN void vkm_semaphore_timeline_wait(vkm_device instanceHandle, VkSemaphore semaphore, uint64_t value) {
 	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
 
-	VkSemaphoreWaitInfo waitInfo = {};
-	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
-
-	vkm::std::array semaphores = {
-		semaphore,
-	};
-	vkm::std::array<uint64_t, semaphores.size()> values = {
-		value,
-	};
-	waitInfo.semaphoreCount = semaphores.size();
-	waitInfo.pSemaphores = semaphores.get();
-	waitInfo.pValues = values.get();
-
-	const VkResult ret = VK_PROC_DEVICE(instance, vkWaitSemaphores)(instance->vkDevice, &waitInfo, vkm::std::time::second);
+	const VkResult ret = ::vkm::vk::device::waitSemaphores(instance, 1, &semaphore, &value, 0, vkm::std::time::second);
 	if (ret != VK_SUCCESS) {
 		vkm::fatal(vkm::std::sourceLocation::current(), "Failed waiting on semaphore: %s",
 				   vkm::vk::reflect::toString(ret).cStr());
 	}
 }
+VKM_FN VkResult vkm_semaphore_timeline_waitMany(vkm_device instanceHandle, size_t count, const VkSemaphore* semaphores,
+											   const uint64_t* values, VkSemaphoreWaitFlags flags, uint64_t timeout) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+
+	if (count == 0) {
+		return VK_SUCCESS;
+	}
+	const VkResult ret =
+		::vkm::vk::device::waitSemaphores(instance, static_cast<uint32_t>(count), semaphores, values, flags, timeout);
+	if (ret != VK_SUCCESS && ret != VK_TIMEOUT) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed waiting on semaphore: %s",
+				   vkm::vk::reflect::toString(ret).cStr());
+	}
+	return ret;
+}
 VKM_FN uint64_t vkm_semaphore_timeline_getValue(vkm_device instanceHandle, VkSemaphore semaphore) {
 	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
 	uint64_t value = 0;
@@ -105,4 +120,9 @@ VKM_FN uint64_t vkm_semaphore_timeline_getValue(vkm_device instanceHandle, VkSem
 	}
 	return value;
 }
+VKM_FN void vkm_semaphore_timeline_onReached(vkm_device instanceHandle, VkSemaphore semaphore, uint64_t value,
+											 vkm_semaphore_timeline_callback callback, void* userdata) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	instance->timelineWaiter.onReached(semaphore, value, callback, userdata);
+}
 }
@@ -0,0 +1,748 @@
+/*
+Copyright 2026 The goARRG Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "vkm/vkm.h"  // IWYU pragma: associated
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+#include "vkm/std/algorithm.hpp"
+#include "vkm/std/defer.hpp"
+#include "vkm/std/stdlib.hpp"
+#include "vkm/std/string.hpp"
+#include "vkm/std/utility.hpp"
+#include "vkm/std/vector.hpp"
+
+#include "vkm.hpp"
+#include "vklog.hpp"
+#include "reflect_const.hpp"
+#include "device/device.hpp"
+#include "device/vma/vma.hpp"
+#include "sparse/sparse.hpp"
+
+namespace vkm::vk {
+void sparseBinder::retire() noexcept {
+	if (this->retiredFrees.size() == 0) {
+		return;
+	}
+	const uint64_t completedValue =
+		vkm_semaphore_timeline_getValue(this->instance->handle(), this->semaphore.vkSemaphore);
+	while (this->retiredFrees.size() > 0 && this->retiredFrees[0].first <= completedValue) {
+		this->freeTile(this->retiredFrees.dequeueFront().second);
+	}
+}
+void sparseBinder::freeTile(VmaAllocation tile) noexcept {
+	VmaAllocationInfo allocInfo;
+	vmaGetAllocationInfo(this->instance->vma.allocator, tile, &allocInfo);
+	this->committedBytes -= allocInfo.size;
+	vmaFreeMemory(this->instance->vma.allocator, tile);
+}
+VmaPool sparseBinder::pool(uint32_t memoryTypeBits) noexcept {
+	// keep the BAR heap for the resources that need host access
+	uint32_t typeBits = memoryTypeBits & this->instance->vma.noBARMemoryTypeBits;
+	if (typeBits == 0) {
+		typeBits = memoryTypeBits;
+	}
+	VmaAllocationCreateInfo allocCreateInfo = {};
+	allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+	uint32_t memoryTypeIndex;
+	VkResult ret = vmaFindMemoryTypeIndex(this->instance->vma.allocator, typeBits, &allocCreateInfo, &memoryTypeIndex);
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to find memory type for sparse tiles: %s",
+				   vkm::vk::reflect::toString(ret).cStr());
+	}
+	const size_t i = vkm::std::linearSearch(this->pools.size(),
+											[&](size_t i) -> bool { return this->pools[i].first == memoryTypeIndex; });
+	if (i < this->pools.size()) {
+		return this->pools[i].second;
+	}
+
+	VmaPoolCreateInfo poolInfo = {};
+	poolInfo.memoryTypeIndex = memoryTypeIndex;
+	poolInfo.blockSize = this->blockSize;
+
+	VmaPool pool;
+	ret = vmaCreatePool(this->instance->vma.allocator, &poolInfo, &pool);
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create sparse tile pool: %s",
+				   vkm::vk::reflect::toString(ret).cStr());
+	}
+	vkm::std::debugRun([&]() {
+		vkm::std::stringbuilder builder;
+		builder << this->name << "_pool_" << memoryTypeIndex;
+		vmaSetPoolName(this->instance->vma.allocator, pool, builder.cStr());
+	});
+	this->pools.pushBack(vkm::std::pair{memoryTypeIndex, pool});
+	return pool;
+}
+VkResult sparseBinder::allocateTiles(const VkMemoryRequirements& requirements, uint32_t count,
+									 VmaAllocation** tiles) noexcept {
+	if (count == 0) {
+		return VK_SUCCESS;
+	}
+	VmaAllocationCreateInfo allocCreateInfo = {};
+	allocCreateInfo.pool = this->pool(requirements.memoryTypeBits);
+
+	// every tile has the same requirements so the whole batch usually goes through vmaAllocateMemoryPages
+	vkm::std::vector<VkMemoryRequirements> tileRequirements(count, count, requirements);
+	vkm::std::vector<VmaAllocation> allocations(count);
+	vkm::std::vector<VkResult> results(count);
+	vkm::vk::device::allocateMemoryBatch(this->instance, allocCreateInfo, false, count, tileRequirements.get(),
+										 allocations.get(), results.get());
+
+	VkResult ret = VK_SUCCESS;
+	for (uint32_t i = 0; i < count; i++) {
+		if (results[i] != VK_SUCCESS) {
+			ret = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+			continue;
+		}
+		*tiles[i] = allocations[i];
+		this->committedBytes += requirements.size;
+	}
+	return ret;
+}
+void sparseBinder::bindBuffer(VkBuffer vkBuffer, VkSparseMemoryBind bind) noexcept {
+	size_t i = vkm::std::linearSearch(this->pendingBuffers.size(),
+									  [&](size_t i) -> bool { return this->pendingBuffers[i].vkBuffer == vkBuffer; });
+	if (i == this->pendingBuffers.size()) {
+		this->pendingBuffers.pushBack(pendingBuffer{.vkBuffer = vkBuffer});
+	}
+	auto& binds = this->pendingBuffers[i].binds;
+
+	// neighbouring pages backed by neighbouring memory become a single bind, as do neighbouring unbinds
+	if (binds.size() > 0) {
+		auto& last = binds.last();
+		if (last.resourceOffset + last.size == bind.resourceOffset && last.memory == bind.memory
+			&& (bind.memory == VK_NULL_HANDLE || last.memoryOffset + last.size == bind.memoryOffset)) {
+			last.size += bind.size;
+			return;
+		}
+	}
+	binds.pushBack(bind);
+	this->numPendingBinds++;
+}
+void sparseBinder::bindImage(VkImage vkImage, VkSparseImageMemoryBind bind) noexcept {
+	size_t i = vkm::std::linearSearch(this->pendingImages.size(),
+									  [&](size_t i) -> bool { return this->pendingImages[i].vkImage == vkImage; });
+	if (i == this->pendingImages.size()) {
+		this->pendingImages.pushBack(pendingImage{.vkImage = vkImage});
+	}
+	this->pendingImages[i].binds.pushBack(bind);
+	this->numPendingBinds++;
+}
+void sparseBinder::bindImageOpaque(VkImage vkImage, VkSparseMemoryBind bind) noexcept {
+	size_t i = vkm::std::linearSearch(this->pendingImages.size(),
+									  [&](size_t i) -> bool { return this->pendingImages[i].vkImage == vkImage; });
+	if (i == this->pendingImages.size()) {
+		this->pendingImages.pushBack(pendingImage{.vkImage = vkImage});
+	}
+	this->pendingImages[i].opaqueBinds.pushBack(bind);
+	this->numPendingBinds++;
+}
+void sparseBinder::evictTile(VmaAllocation* tile) noexcept {
+	this->pendingFrees.pushBack(*tile);
+	*tile = nullptr;
+}
+uint64_t sparseBinder::submit(uint32_t waitCount, const vkm_completionToken* waits) noexcept {
+	if (this->numPendingBinds == 0) {
+		return this->semaphore.pendingValue;
+	}
+
+	vkm::std::vector<VkSparseBufferMemoryBindInfo> bufferBinds;
+	for (const auto& pending : this->pendingBuffers) {
+		if (pending.binds.size() == 0) {
+			continue;
+		}
+		bufferBinds.pushBack(VkSparseBufferMemoryBindInfo{
+			.buffer = pending.vkBuffer,
+			.bindCount = static_cast<uint32_t>(pending.binds.size()),
+			.pBinds = pending.binds.get(),
+		});
+	}
+	vkm::std::vector<VkSparseImageOpaqueMemoryBindInfo> imageOpaqueBinds;
+	vkm::std::vector<VkSparseImageMemoryBindInfo> imageBinds;
+	for (const auto& pending : this->pendingImages) {
+		if (pending.opaqueBinds.size() > 0) {
+			imageOpaqueBinds.pushBack(VkSparseImageOpaqueMemoryBindInfo{
+				.image = pending.vkImage,
+				.bindCount = static_cast<uint32_t>(pending.opaqueBinds.size()),
+				.pBinds = pending.opaqueBinds.get(),
+			});
+		}
+		if (pending.binds.size() > 0) {
+			imageBinds.pushBack(VkSparseImageMemoryBindInfo{
+				.image = pending.vkImage,
+				.bindCount = static_cast<uint32_t>(pending.binds.size()),
+				.pBinds = pending.binds.get(),
+			});
+		}
+	}
+
+	vkm::std::vector<VkSemaphore> waitSemaphores;
+	vkm::std::vector<uint64_t> waitValues;
+	for (uint32_t i = 0; i < waitCount; i++) {
+		if (waits[i].vkSemaphore == VK_NULL_HANDLE) {
+			continue;
+		}
+		waitSemaphores.pushBack(waits[i].vkSemaphore);
+		waitValues.pushBack(waits[i].value);
+	}
+
+	const uint64_t signalValue = this->semaphore.pendingValue + 1;
+	const VkTimelineSemaphoreSubmitInfo timelineInfo = {
+		.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+		.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size()),
+		.pWaitSemaphoreValues = waitValues.get(),
+		.signalSemaphoreValueCount = 1,
+		.pSignalSemaphoreValues = &signalValue,
+	};
+	const VkBindSparseInfo bindInfo = {
+		.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO,
+		.pNext = &timelineInfo,
+		.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size()),
+		.pWaitSemaphores = waitSemaphores.get(),
+		.bufferBindCount = static_cast<uint32_t>(bufferBinds.size()),
+		.pBufferBinds = bufferBinds.get(),
+		.imageOpaqueBindCount = static_cast<uint32_t>(imageOpaqueBinds.size()),
+		.pImageOpaqueBinds = imageOpaqueBinds.get(),
+		.imageBindCount = static_cast<uint32_t>(imageBinds.size()),
+		.pImageBinds = imageBinds.get(),
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores = &this->semaphore.vkSemaphore,
+	};
+	const VkResult ret = VK_PROC_DEVICE(this->instance, vkQueueBindSparse)(this->vkQueue, 1, &bindInfo, VK_NULL_HANDLE);
+	if (ret != VK_SUCCESS) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Failed to submit sparse binds: %s",
+				   vkm::vk::reflect::toString(ret).cStr());
+	}
+
+	this->semaphore.pendingValue = signalValue;
+	for (auto tile : this->pendingFrees) {
+		this->retiredFrees.pushBack(vkm::std::pair{this->semaphore.pendingValue, tile});
+	}
+	this->pendingFrees.resize(0);
+	this->pendingBuffers.resize(0);
+	this->pendingImages.resize(0);
+	this->numPendingBinds = 0;
+	return signalValue;
+}
+void sparseBinder::destroy(pageTable* table) noexcept {
+	// binds already submitted may still reference the resource
+	vkm_semaphore_timeline_wait(this->instance->handle(), this->semaphore.vkSemaphore, this->semaphore.pendingValue);
+	this->retire();
+
+	// pending binds of the resource are dropped, the tiles they bind are freed below
+	if (table->type == VK_OBJECT_TYPE_BUFFER) {
+		for (auto& pending : this->pendingBuffers) {
+			if (pending.vkBuffer == table->vkBuffer) {
+				this->numPendingBinds -= pending.binds.size();
+				pending.binds.resize(0);
+			}
+		}
+	} else {
+		for (auto& pending : this->pendingImages) {
+			if (pending.vkImage == table->vkImage) {
+				this->numPendingBinds -= pending.binds.size() + pending.opaqueBinds.size();
+				pending.binds.resize(0);
+				pending.opaqueBinds.resize(0);
+			}
+		}
+	}
+	// with nothing left to submit the tiles of dropped unbinds would never retire, nothing uses them anymore
+	if (this->numPendingBinds == 0) {
+		for (auto tile : this->pendingFrees) {
+			this->freeTile(tile);
+		}
+		this->pendingFrees.resize(0);
+	}
+
+	for (auto tile : table->tiles) {
+		if (tile != nullptr) {
+			this->freeTile(tile);
+		}
+	}
+	for (auto tile : table->mipTail.tails) {
+		if (tile != nullptr) {
+			this->freeTile(tile);
+		}
+	}
+	if (table->type == VK_OBJECT_TYPE_BUFFER) {
+		VK_PROC_DEVICE(this->instance, vkDestroyBuffer)(this->instance->vkDevice, table->vkBuffer, nullptr);
+	} else {
+		VK_PROC_DEVICE(this->instance, vkDestroyImage)(this->instance->vkDevice, table->vkImage, nullptr);
+	}
+	delete table;
+}
+}  // namespace vkm::vk
+
+// calls fn(tileIndex, offset, extent) for every tile overlapping the region, the region must be before the mip tail
+template <typename F>
+static void forEachTile(const vkm::vk::pageTable* table, vkm_sparseImageRegion region, F fn) noexcept {
+	const VkExtent3D mipExtent = table->mipExtent(region.mipLevel);
+	if (region.extent.width == 0) {
+		region.offset = {};
+		region.extent = mipExtent;
+	}
+	if (region.offset.x < 0 || region.offset.y < 0 || region.offset.z < 0) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Sparse image region has a negative offset");
+	}
+
+	const VkExtent3D& tile = table->tileExtent;
+	const VkExtent3D numTiles = table->mipTiles(region.mipLevel);
+	const auto tileRange = [](uint32_t offset, uint32_t extent, uint32_t tileSize, uint32_t count) {
+		return vkm::std::pair{
+			vkm::std::min(offset / tileSize, count),
+			vkm::std::min((offset + extent + tileSize - 1) / tileSize, count),
+		};
+	};
+	const auto x = tileRange(region.offset.x, region.extent.width, tile.width, numTiles.width);
+	const auto y = tileRange(region.offset.y, region.extent.height, tile.height, numTiles.height);
+	const auto z = tileRange(region.offset.z, region.extent.depth, tile.depth, numTiles.depth);
+
+	const uint32_t base =
+		(region.arrayLayer * table->mipTileOffsets.last()) + table->mipTileOffsets[region.mipLevel];
+	for (uint32_t k = z.first; k < z.second; k++) {
+		for (uint32_t j = y.first; j < y.second; j++) {
+			for (uint32_t i = x.first; i < x.second; i++) {
+				const VkOffset3D offset = {
+					static_cast<int32_t>(i * tile.width),
+					static_cast<int32_t>(j * tile.height),
+					static_cast<int32_t>(k * tile.depth),
+				};
+				// tiles on the edge of the mip level only cover what is left of it
+				const VkExtent3D extent = {
+					vkm::std::min(tile.width, mipExtent.width - (i * tile.width)),
+					vkm::std::min(tile.height, mipExtent.height - (j * tile.height)),
+					vkm::std::min(tile.depth, mipExtent.depth - (k * tile.depth)),
+				};
+				fn(base + (((k * numTiles.height) + j) * numTiles.width) + i, offset, extent);
+			}
+		}
+	}
+}
+
+static void checkRegion(const vkm::vk::pageTable* table, vkm_sparseImageRegion region) noexcept {
+	if (region.mipLevel >= table->mipLevels || region.arrayLayer >= table->arrayLayers) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Sparse image region [mip %d, layer %d] is outside the image",
+				   region.mipLevel, region.arrayLayer);
+	}
+}
+
+extern "C" {
+VKM_FN void vkm_createSparseBinder(vkm_device instanceHandle, vkm_string name, vkm_sparseBinderCreateInfo info,
+								   vkm_sparseBinder* binderHandle) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	if (!instance->optionalFeatures.hasSparseBinding) {
+		vkm::fatal("Cannot create sparse binder without the sparseBinding feature");
+	}
+	{
+		uint32_t numFamilies = 0;
+		VK_PROC(vkGetPhysicalDeviceQueueFamilyProperties)(instance->vkPhysicalDevice, &numFamilies, nullptr);
+		vkm::std::vector<VkQueueFamilyProperties> families(numFamilies);
+		VK_PROC(vkGetPhysicalDeviceQueueFamilyProperties)(instance->vkPhysicalDevice, &numFamilies, families.get());
+		if (info.queueFamily >= numFamilies
+			|| (families[info.queueFamily].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT) == 0) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Queue family %d does not support sparse binding",
+					   info.queueFamily);
+		}
+	}
+	auto* b = new (::std::nothrow)::vkm::vk::sparseBinder();
+
+	b->instance = instance;
+	if (name.len != 0 && name.ptr != nullptr) {
+		vkm::std::stringbuilder builder;
+		builder << name << "_sparseBinder_" << info.queueFamily << "_" << info.queueIndex;
+		b->name = builder.str();
+	} else {
+		vkm::std::stringbuilder builder;
+		builder << "sparseBinder_" << info.queueFamily << "_" << info.queueIndex;
+		b->name = builder.str();
+	}
+	VK_PROC_DEVICE(instance, vkGetDeviceQueue)(instance->vkDevice, info.queueFamily, info.queueIndex, &b->vkQueue);
+
+	{
+		b->semaphore.pendingValue = 0;
+		vkm_createTimelineSemaphore(instanceHandle, b->name.vkm_string(), b->semaphore.pendingValue,
+									&b->semaphore.vkSemaphore);
+	}
+	b->blockSize = info.blockSize != 0 ? info.blockSize : VKM_SPARSE_BINDER_DEFAULT_BLOCK_SIZE;
+	b->committedBytes = 0;
+	b->numPendingBinds = 0;
+
+	*binderHandle = b->handle();
+}
+VKM_FN void vkm_destroySparseBinder(vkm_sparseBinder binderHandle) {
+	auto* b = ::vkm::vk::sparseBinder::fromHandle(binderHandle);
+	auto* instance = b->instance;
+
+	b->mutex.lock();
+	const uint64_t value = b->submit(0, nullptr);
+	b->mutex.unlock();
+	vkm_semaphore_timeline_wait(instance->handle(), b->semaphore.vkSemaphore, value);
+	b->retire();
+
+	if (b->committedBytes != 0) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Sparse binder destroyed with %llu bytes still committed",
+				   static_cast<unsigned long long>(b->committedBytes));
+	}
+	for (auto& pool : b->pools) {
+		vmaDestroyPool(instance->vma.allocator, pool.second);
+	}
+	vkm_destroyTimelineSemaphore(instance->handle(), b->semaphore.vkSemaphore);
+	delete b;
+}
+VKM_FN VkResult vkm_createSparseBuffer(vkm_sparseBinder binderHandle, vkm_string name, VkBufferCreateInfo info,
+									   vkm_sparseBuffer* buffer) {
+	auto* b = ::vkm::vk::sparseBinder::fromHandle(binderHandle);
+	auto* instance = b->instance;
+	if (!instance->optionalFeatures.hasSparseResidencyBuffer) {
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+	}
+
+	info.flags |= VK_BUFFER_CREATE_SPARSE_BINDING_BIT | VK_BUFFER_CREATE_SPARSE_RESIDENCY_BIT;
+	VkBuffer vkBuffer;
+	const VkResult ret = VK_PROC_DEVICE(instance, vkCreateBuffer)(instance->vkDevice, &info, nullptr, &vkBuffer);
+	if (ret != VK_SUCCESS) {
+		return ret;
+	}
+
+	auto* table = new (::std::nothrow)::vkm::vk::pageTable();
+	table->type = VK_OBJECT_TYPE_BUFFER;
+	table->vkBuffer = vkBuffer;
+	// the alignment of a sparse resource is its sparse block size
+	VK_PROC_DEVICE(instance, vkGetBufferMemoryRequirements)(instance->vkDevice, vkBuffer, &table->tileRequirements);
+	table->size = table->tileRequirements.size;
+	table->tileRequirements.size = table->tileRequirements.alignment;
+	table->tiles.resize((table->size + table->tileRequirements.size - 1) / table->tileRequirements.size, nullptr);
+
+	*buffer = vkm_sparseBuffer{
+		.allocation = table->handle(),
+		.vkBuffer = vkBuffer,
+		.pageSize = table->tileRequirements.size,
+	};
+	vkm::std::debugRun([=]() {
+		vkm::std::stringbuilder builder;
+		builder.write(name).write("_sparseBuffer");
+		vkm::vk::debugLabel(instance->vkDevice, vkBuffer, builder.cStr());
+	});
+	return VK_SUCCESS;
+}
+VKM_FN void vkm_destroySparseBuffer(vkm_sparseBinder binderHandle, vkm_sparseBuffer buffer) {
+	auto* b = ::vkm::vk::sparseBinder::fromHandle(binderHandle);
+	b->mutex.lock();
+	DEFER([&] { b->mutex.unlock(); });
+
+	b->destroy(::vkm::vk::pageTable::fromHandle(buffer.allocation));
+}
+VKM_FN VkResult vkm_sparseBuffer_commit(vkm_sparseBinder binderHandle, vkm_sparseBuffer buffer, VkDeviceSize offset,
+										VkDeviceSize size) {
+	auto* b = ::vkm::vk::sparseBinder::fromHandle(binderHandle);
+	auto* table = ::vkm::vk::pageTable::fromHandle(buffer.allocation);
+	if (offset + size > table->size) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Sparse buffer range [%llu, %llu) is outside of the buffer",
+				   static_cast<unsigned long long>(offset), static_cast<unsigned long long>(offset + size));
+	}
+	if (size == 0) {
+		return VK_SUCCESS;
+	}
+	b->mutex.lock();
+	DEFER([&] { b->mutex.unlock(); });
+	b->retire();
+
+	const VkDeviceSize pageSize = table->tileRequirements.size;
+	vkm::std::vector<VmaAllocation*> missing;
+	for (VkDeviceSize i = offset / pageSize; i < (offset + size + pageSize - 1) / pageSize; i++) {
+		if (table->tiles[i] == nullptr) {
+			missing.pushBack(&table->tiles[i]);
+		}
+	}
+	const VkResult ret =
+		b->allocateTiles(table->tileRequirements, static_cast<uint32_t>(missing.size()), missing.get());
+	for (auto* tile : missing) {
+		if (*tile == nullptr) {
+			continue;
+		}
+		const VkDeviceSize resourceOffset = static_cast<VkDeviceSize>(tile - table->tiles.get()) * pageSize;
+		VmaAllocationInfo allocInfo;
+		vmaGetAllocationInfo(b->instance->vma.allocator, *tile, &allocInfo);
+		b->bindBuffer(table->vkBuffer, VkSparseMemoryBind{
+										   .resourceOffset = resourceOffset,
+										   .size = vkm::std::min(pageSize, table->size - resourceOffset),
+										   .memory = allocInfo.deviceMemory,
+										   .memoryOffset = allocInfo.offset,
+									   });
+	}
+	return ret;
+}
+VKM_FN void vkm_sparseBuffer_evict(vkm_sparseBinder binderHandle, vkm_sparseBuffer buffer, VkDeviceSize offset,
+								   VkDeviceSize size) {
+	auto* b = ::vkm::vk::sparseBinder::fromHandle(binderHandle);
+	auto* table = ::vkm::vk::pageTable::fromHandle(buffer.allocation);
+	if (offset + size > table->size) {
+		vkm::fatal(vkm::std::sourceLocation::current(), "Sparse buffer range [%llu, %llu) is outside of the buffer",
+				   static_cast<unsigned long long>(offset), static_cast<unsigned long long>(offset + size));
+	}
+	if (size == 0) {
+		return;
+	}
+	b->mutex.lock();
+	DEFER([&] { b->mutex.unlock(); });
+
+	const VkDeviceSize pageSize = table->tileRequirements.size;
+	for (VkDeviceSize i = offset / pageSize; i < (offset + size + pageSize - 1) / pageSize; i++) {
+		if (table->tiles[i] == nullptr) {
+			continue;
+		}
+		b->bindBuffer(table->vkBuffer, VkSparseMemoryBind{
+										   .resourceOffset = i * pageSize,
+										   .size = vkm::std::min(pageSize, table->size - (i * pageSize)),
+									   });
+		b->evictTile(&table->tiles[i]);
+	}
+}
+VKM_FN VkResult vkm_createSparseImage(vkm_sparseBinder binderHandle, vkm_string name, VkImageCreateInfo info,
+									  vkm_sparseImage* image) {
+	auto* b = ::vkm::vk::sparseBinder::fromHandle(binderHandle);
+	auto* instance = b->instance;
+	{
+		const auto& features = instance->optionalFeatures;
+		const bool residency = (info.imageType == VK_IMAGE_TYPE_2D && features.hasSparseResidencyImage2D)
+							   || (info.imageType == VK_IMAGE_TYPE_3D && features.hasSparseResidencyImage3D);
+		if (!residency || info.samples != VK_SAMPLE_COUNT_1_BIT) {
+			return VK_ERROR_FEATURE_NOT_PRESENT;
+		}
+	}
+	info.flags |= VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+	{
+		const VkPhysicalDeviceSparseImageFormatInfo2 formatInfo = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SPARSE_IMAGE_FORMAT_INFO_2,
+			.format = info.format,
+			.type = info.imageType,
+			.samples = info.samples,
+			.usage = info.usage,
+			.tiling = info.tiling,
+		};
+		uint32_t count = 0;
+		VK_PROC(vkGetPhysicalDeviceSparseImageFormatProperties2)
+		(instance->vkPhysicalDevice, &formatInfo, &count, nullptr);
+		if (count != 1) {
+			return VK_ERROR_FORMAT_NOT_SUPPORTED;
+		}
+		VkSparseImageFormatProperties2 properties = {.sType = VK_STRUCTURE_TYPE_SPARSE_IMAGE_FORMAT_PROPERTIES_2};
+		VK_PROC(vkGetPhysicalDeviceSparseImageFormatProperties2)
+		(instance->vkPhysicalDevice, &formatInfo, &count, &properties);
+		if (properties.properties.aspectMask != VK_IMAGE_ASPECT_COLOR_BIT) {
+			return VK_ERROR_FORMAT_NOT_SUPPORTED;
+		}
+	}
+
+	VkImage vkImage;
+	{
+		const VkResult ret = VK_PROC_DEVICE(instance, vkCreateImage)(instance->vkDevice, &info, nullptr, &vkImage);
+		if (ret != VK_SUCCESS) {
+			return ret;
+		}
+	}
+	// a second requirement would be the metadata aspect which is not supported
+	VkSparseImageMemoryRequirements2 sparseRequirements = {
+		.sType = VK_STRUCTURE_TYPE_SPARSE_IMAGE_MEMORY_REQUIREMENTS_2,
+	};
+	{
+		const VkImageSparseMemoryRequirementsInfo2 requirementsInfo = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_SPARSE_MEMORY_REQUIREMENTS_INFO_2,
+			.image = vkImage,
+		};
+		uint32_t count = 0;
+		VK_PROC_DEVICE(instance, vkGetImageSparseMemoryRequirements2)
+		(instance->vkDevice, &requirementsInfo, &count, nullptr);
+		if (count != 1) {
+			VK_PROC_DEVICE(instance, vkDestroyImage)(instance->vkDevice, vkImage, nullptr);
+			return VK_ERROR_FORMAT_NOT_SUPPORTED;
+		}
+		VK_PROC_DEVICE(instance, vkGetImageSparseMemoryRequirements2)
+		(instance->vkDevice, &requirementsInfo, &count, &sparseRequirements);
+	}
+	const auto& requirements = sparseRequirements.memoryRequirements;
+
+	auto* table = new (::std::nothrow)::vkm::vk::pageTable();
+	table->type = VK_OBJECT_TYPE_IMAGE;
+	table->vkImage = vkImage;
+	VK_PROC_DEVICE(instance, vkGetImageMemoryRequirements)(instance->vkDevice, vkImage, &table->tileRequirements);
+	table->tileRequirements.size = table->tileRequirements.alignment;
+	table->extent = info.extent;
+	table->tileExtent = requirements.formatProperties.imageGranularity;
+	table->mipLevels = info.mipLevels;
+	table->arrayLayers = info.arrayLayers;
+
+	table->mipTail.firstLod = vkm::std::min(requirements.imageMipTailFirstLod, info.mipLevels);
+	table->mipTail.size = requirements.imageMipTailSize;
+	table->mipTail.offset = requirements.imageMipTailOffset;
+	table->mipTail.stride = requirements.imageMipTailStride;
+	if (table->mipTail.firstLod < info.mipLevels) {
+		const bool single = (requirements.formatProperties.flags & VK_SPARSE_IMAGE_FORMAT_SINGLE_MIPTAIL_BIT) != 0;
+		table->mipTail.tails.resize(single ? 1 : info.arrayLayers, nullptr);
+	}
+
+	uint32_t tilesPerLayer = 0;
+	for (uint32_t mip = 0; mip < table->mipTail.firstLod; mip++) {
+		table->mipTileOffsets.pushBack(tilesPerLayer);
+		const VkExtent3D numTiles = table->mipTiles(mip);
+		tilesPerLayer += numTiles.width * numTiles.height * numTiles.depth;
+	}
+	table->mipTileOffsets.pushBack(tilesPerLayer);
+	table->tiles.resize(static_cast<size_t>(tilesPerLayer) * info.arrayLayers, nullptr);
+
+	*image = vkm_sparseImage{
+		.allocation = table->handle(),
+		.vkImage = vkImage,
+		.tileExtent = table->tileExtent,
+		.mipTailFirstLod = table->mipTail.firstLod,
+	};
+	vkm::std::debugRun([=]() {
+		vkm::std::stringbuilder builder;
+		builder.write(name).write("_sparseImage");
+		vkm::vk::debugLabel(instance->vkDevice, vkImage, builder.cStr());
+	});
+	return VK_SUCCESS;
+}
+VKM_FN void vkm_destroySparseImage(vkm_sparseBinder binderHandle, vkm_sparseImage image) {
+	auto* b = ::vkm::vk::sparseBinder::fromHandle(binderHandle);
+	b->mutex.lock();
+	DEFER([&] { b->mutex.unlock(); });
+
+	b->destroy(::vkm::vk::pageTable::fromHandle(image.allocation));
+}
+VKM_FN VkResult vkm_sparseImage_commit(vkm_sparseBinder binderHandle, vkm_sparseImage image,
+									   vkm_sparseImageRegion region) {
+	auto* b = ::vkm::vk::sparseBinder::fromHandle(binderHandle);
+	auto* table = ::vkm::vk::pageTable::fromHandle(image.allocation);
+	checkRegion(table, region);
+	b->mutex.lock();
+	DEFER([&] { b->mutex.unlock(); });
+	b->retire();
+
+	if (region.mipLevel >= table->mipTail.firstLod) {
+		const uint32_t i = table->mipTail.tails.size() == 1 ? 0 : region.arrayLayer;
+		VmaAllocation* tail = &table->mipTail.tails[i];
+		if (*tail != nullptr) {
+			return VK_SUCCESS;
+		}
+		VkMemoryRequirements requirements = table->tileRequirements;
+		requirements.size = table->mipTail.size;
+		const VkResult ret = b->allocateTiles(requirements, 1, &tail);
+		if (ret != VK_SUCCESS) {
+			return ret;
+		}
+		VmaAllocationInfo allocInfo;
+		vmaGetAllocationInfo(b->instance->vma.allocator, *tail, &allocInfo);
+		b->bindImageOpaque(table->vkImage, VkSparseMemoryBind{
+											   .resourceOffset = table->mipTail.offset + (i * table->mipTail.stride),
+											   .size = table->mipTail.size,
+											   .memory = allocInfo.deviceMemory,
+											   .memoryOffset = allocInfo.offset,
+										   });
+		return VK_SUCCESS;
+	}
+
+	vkm::std::vector<VmaAllocation*> missing;
+	vkm::std::vector<VkSparseImageMemoryBind> binds;
+	forEachTile(table, region, [&](uint32_t i, VkOffset3D offset, VkExtent3D extent) {
+		if (table->tiles[i] != nullptr) {
+			return;
+		}
+		missing.pushBack(&table->tiles[i]);
+		binds.pushBack(VkSparseImageMemoryBind{
+			.subresource = {VK_IMAGE_ASPECT_COLOR_BIT, region.mipLevel, region.arrayLayer},
+			.offset = offset,
+			.extent = extent,
+		});
+	});
+	const VkResult ret =
+		b->allocateTiles(table->tileRequirements, static_cast<uint32_t>(missing.size()), missing.get());
+	for (size_t i = 0; i < missing.size(); i++) {
+		if (*missing[i] == nullptr) {
+			continue;
+		}
+		VmaAllocationInfo allocInfo;
+		vmaGetAllocationInfo(b->instance->vma.allocator, *missing[i], &allocInfo);
+		binds[i].memory = allocInfo.deviceMemory;
+		binds[i].memoryOffset = allocInfo.offset;
+		b->bindImage(table->vkImage, binds[i]);
+	}
+	return ret;
+}
+VKM_FN void vkm_sparseImage_evict(vkm_sparseBinder binderHandle, vkm_sparseImage image, vkm_sparseImageRegion region) {
+	auto* b = ::vkm::vk::sparseBinder::fromHandle(binderHandle);
+	auto* table = ::vkm::vk::pageTable::fromHandle(image.allocation);
+	checkRegion(table, region);
+	b->mutex.lock();
+	DEFER([&] { b->mutex.unlock(); });
+
+	if (region.mipLevel >= table->mipTail.firstLod) {
+		const uint32_t i = table->mipTail.tails.size() == 1 ? 0 : region.arrayLayer;
+		if (table->mipTail.tails[i] == nullptr) {
+			return;
+		}
+		b->bindImageOpaque(table->vkImage, VkSparseMemoryBind{
+											   .resourceOffset = table->mipTail.offset + (i * table->mipTail.stride),
+											   .size = table->mipTail.size,
+										   });
+		b->evictTile(&table->mipTail.tails[i]);
+		return;
+	}
+
+	forEachTile(table, region, [&](uint32_t i, VkOffset3D offset, VkExtent3D extent) {
+		if (table->tiles[i] == nullptr) {
+			return;
+		}
+		b->bindImage(table->vkImage, VkSparseImageMemoryBind{
+										 .subresource = {VK_IMAGE_ASPECT_COLOR_BIT, region.mipLevel, region.arrayLayer},
+										 .offset = offset,
+										 .extent = extent,
+									 });
+		b->evictTile(&table->tiles[i]);
+	});
+}
+VKM_FN vkm_completionToken vkm_sparseBinder_flush(vkm_sparseBinder binderHandle, uint32_t waitCount,
+												  const vkm_completionToken* waits) {
+	auto* b = ::vkm::vk::sparseBinder::fromHandle(binderHandle);
+	b->mutex.lock();
+	DEFER([&] { b->mutex.unlock(); });
+
+	b->retire();
+	return vkm_completionToken{
+		.vkSemaphore = b->semaphore.vkSemaphore,
+		.value = b->submit(waitCount, waits),
+	};
+}
+VKM_FN void vkm_sparseBinder_getStats(vkm_sparseBinder binderHandle, vkm_sparseBinderStats* stats) {
+	auto* b = ::vkm::vk::sparseBinder::fromHandle(binderHandle);
+	b->mutex.lock();
+	DEFER([&] { b->mutex.unlock(); });
+
+	*stats = vkm_sparseBinderStats{
+		.committedBytes = b->committedBytes,
+		.pendingBinds = static_cast<uint32_t>(b->numPendingBinds),
+	};
+	for (auto& pool : b->pools) {
+		VmaStatistics poolStats;
+		vmaGetPoolStatistics(b->instance->vma.allocator, pool.second, &poolStats);
+		stats->poolBytes += poolStats.blockBytes;
+	}
+}
+}
@@ -0,0 +1,145 @@
+/*
+Copyright 2026 The goARRG Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#ifndef __cplusplus
+#error C++ only header
+#endif
+
+#include <stdint.h>
+
+#include "vkm/std/string.hpp"
+#include "vkm/std/vector.hpp"
+#include "vkm/std/ringbuffer.hpp"
+#include "vkm/std/thread.hpp"
+#include "vkm/std/utility.hpp"
+
+#include "vkm/vkm.h"
+#include "vkm.hpp"
+#include "device/device.hpp"
+#include "device/vma/vma.hpp"
+
+namespace vkm::vk {
+// tracks which tiles of a sparse buffer or image are resident, tiles[i] is null while tile i is not.
+// buffer tiles are laid out by offset, image tiles by layer, then mip level, then z, y, x
+struct pageTable {
+	VkObjectType type;
+	VkBuffer vkBuffer;
+	VkImage vkImage;
+	// size is the size of a single tile
+	VkMemoryRequirements tileRequirements;
+	vkm::std::vector<VmaAllocation> tiles;
+
+	// buffers only
+	VkDeviceSize size;
+
+	// images only
+	VkExtent3D extent;
+	VkExtent3D tileExtent;
+	uint32_t mipLevels;
+	uint32_t arrayLayers;
+	// index of the first tile of every mip level before the mip tail within a layer, last entry is the tiles per layer
+	vkm::std::vector<uint32_t> mipTileOffsets;
+	struct {
+		uint32_t firstLod;
+		VkDeviceSize size;
+		VkDeviceSize offset;
+		VkDeviceSize stride;
+		// one allocation per layer or a single one with VK_SPARSE_IMAGE_FORMAT_SINGLE_MIPTAIL_BIT
+		vkm::std::vector<VmaAllocation> tails;
+	} mipTail;
+
+	[[nodiscard]] VkExtent3D mipExtent(uint32_t mipLevel) const noexcept {
+		return VkExtent3D{
+			vkm::std::max(this->extent.width >> mipLevel, 1u),
+			vkm::std::max(this->extent.height >> mipLevel, 1u),
+			vkm::std::max(this->extent.depth >> mipLevel, 1u),
+		};
+	}
+	[[nodiscard]] VkExtent3D mipTiles(uint32_t mipLevel) const noexcept {
+		const VkExtent3D e = this->mipExtent(mipLevel);
+		return VkExtent3D{
+			(e.width + this->tileExtent.width - 1) / this->tileExtent.width,
+			(e.height + this->tileExtent.height - 1) / this->tileExtent.height,
+			(e.depth + this->tileExtent.depth - 1) / this->tileExtent.depth,
+		};
+	}
+
+	[[nodiscard]] vkm_allocation handle() noexcept { return reinterpret_cast<vkm_allocation>(this); }
+	[[nodiscard]] static pageTable* fromHandle(vkm_allocation handle) noexcept {
+		return reinterpret_cast<pageTable*>(handle);
+	}
+};
+
+// every public function locks mutex so a binder may be shared between threads
+struct sparseBinder {
+	device::instance* instance;
+	vkm::std::string<char> name;
+	VkQueue vkQueue;
+	VkDeviceSize blockSize;
+	vkm::std::mutex mutex;
+
+	struct {
+		uint64_t pendingValue;
+		VkSemaphore vkSemaphore;
+	} semaphore;
+
+	// tiles are suballocated from one pool per memory type
+	vkm::std::vector<vkm::std::pair<uint32_t, VmaPool>> pools;
+	VkDeviceSize committedBytes;
+
+	struct pendingBuffer {
+		VkBuffer vkBuffer;
+		vkm::std::vector<VkSparseMemoryBind> binds;
+	};
+	struct pendingImage {
+		VkImage vkImage;
+		vkm::std::vector<VkSparseImageMemoryBind> binds;
+		// mip tails are bound through the opaque image binds
+		vkm::std::vector<VkSparseMemoryBind> opaqueBinds;
+	};
+	vkm::std::vector<pendingBuffer> pendingBuffers;
+	vkm::std::vector<pendingImage> pendingImages;
+	// total entries in the pending bind vectors, merged binds count once
+	size_t numPendingBinds;
+
+	// evicted tiles are only returned to their pool once the unbind has completed
+	vkm::std::vector<VmaAllocation> pendingFrees;
+	vkm::std::ringbuffer<vkm::std::pair<uint64_t, VmaAllocation>> retiredFrees;
+
+	// frees evicted tiles whose unbind has completed
+	void retire() noexcept;
+	void freeTile(VmaAllocation) noexcept;
+	[[nodiscard]] VmaPool pool(uint32_t memoryTypeBits) noexcept;
+	// allocates every null entry of tiles, entries that fail stay null
+	[[nodiscard]] VkResult allocateTiles(const VkMemoryRequirements& requirements, uint32_t count,
+										 VmaAllocation** tiles) noexcept;
+	void bindBuffer(VkBuffer, VkSparseMemoryBind) noexcept;
+	void bindImage(VkImage, VkSparseImageMemoryBind) noexcept;
+	void bindImageOpaque(VkImage, VkSparseMemoryBind) noexcept;
+	void evictTile(VmaAllocation* tile) noexcept;
+	// submits every pending bind after the waits, returns the value the submit signals
+	uint64_t submit(uint32_t waitCount, const vkm_completionToken* waits) noexcept;
+	// waits for every submitted bind and drops the pending ones, then frees the resource and its tiles
+	void destroy(pageTable*) noexcept;
+
+	[[nodiscard]] vkm_sparseBinder handle() noexcept { return reinterpret_cast<vkm_sparseBinder>(this); }
+	[[nodiscard]] static sparseBinder* fromHandle(vkm_sparseBinder handle) noexcept {
+		return reinterpret_cast<sparseBinder*>(handle);
+	}
+};
+}  // namespace vkm::vk
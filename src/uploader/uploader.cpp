@@ -0,0 +1,346 @@
+/*
+Copyright 2026 The goARRG Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "vkm/vkm.h"  // IWYU pragma: associated
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <new>
+
+#include "vkm/std/algorithm.hpp"
+#include "vkm/std/defer.hpp"
+#include "vkm/std/stdlib.hpp"
+#include "vkm/std/string.hpp"
+#include "vkm/std/utility.hpp"
+
+#include "vkm.hpp"
+#include "vklog.hpp"
+#include "reflect_const.hpp"
+#include "device/device.hpp"
+#include "device/vma/vma.hpp"
+#include "uploader/uploader.hpp"
+
+namespace vkm::vk {
+void uploader::retire() noexcept {
+	if (this->segments.size() == 0) {
+		return;
+	}
+	const uint64_t completedValue = vkm_semaphore_timeline_getValue(this->instance->handle(), this->semaphore.vkSemaphore);
+	while (this->segments.size() > 0 && this->segments[0].value <= completedValue) {
+		this->segments.dequeueFront();
+	}
+}
+VkDeviceSize uploader::allocate(VkDeviceSize size) noexcept {
+	auto& staging = this->staging;
+	for (;;) {
+		this->retire();
+		if (this->segments.size() == 0 && staging.pendingBegin == staging.head) {
+			staging.head = staging.pendingBegin = 0;
+		}
+
+		// live bytes run from tail up to head, possibly wrapping around the end of the ring
+		const VkDeviceSize tail = this->segments.size() > 0 ? this->segments[0].begin : staging.pendingBegin;
+		const VkDeviceSize offset = ((staging.head + staging.alignment - 1) / staging.alignment) * staging.alignment;
+		if (staging.head >= tail) {
+			if (offset + size <= staging.size) {
+				staging.head = offset + size;
+				return offset;
+			}
+			// strictly less so head never catches up to tail, head == tail only ever means empty
+			if (size < tail) {
+				staging.head = size;
+				return 0;
+			}
+		} else if (offset + size < tail) {
+			staging.head = offset + size;
+			return offset;
+		}
+
+		// full, wait for the oldest submit to free its bytes
+		if (this->numPendingCopies > 0) {
+			(void)this->submit();
+		}
+		const VkResult ret = ::vkm::vk::device::waitSemaphores(this->instance, 1, &this->semaphore.vkSemaphore,
+															   &this->segments[0].value, 0, UINT64_MAX);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed waiting on semaphore: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+	}
+}
+void uploader::record(VkBuffer dst, VkDeviceSize srcOffset, VkDeviceSize dstOffset, VkDeviceSize size) noexcept {
+	size_t i = vkm::std::linearSearch(this->pendingCopies.size(),
+									  [&](size_t i) -> bool { return this->pendingCopies[i].dst == dst; });
+	if (i == this->pendingCopies.size()) {
+		this->pendingCopies.pushBack(pendingCopy{.dst = dst});
+	}
+	auto& regions = this->pendingCopies[i].regions;
+	this->numPendingCopies++;
+
+	// consecutive uploads to consecutive ranges become a single region
+	if (regions.size() > 0) {
+		auto& last = regions.last();
+		if (last.srcOffset + last.size == srcOffset && last.dstOffset + last.size == dstOffset) {
+			last.size += size;
+			return;
+		}
+	}
+	regions.pushBack(VkBufferCopy2{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
+		.srcOffset = srcOffset,
+		.dstOffset = dstOffset,
+		.size = size,
+	});
+}
+uint64_t uploader::submit() noexcept {
+	if (this->numPendingCopies == 0) {
+		return this->semaphore.pendingValue;
+	}
+
+	VkCommandBuffer cb;
+	{
+		const uint64_t completedValue =
+			vkm_semaphore_timeline_getValue(this->instance->handle(), this->semaphore.vkSemaphore);
+		if (this->commandBuffers.size() > 0 && this->commandBuffers[0].first <= completedValue) {
+			cb = this->commandBuffers.dequeueFront().second;
+			const VkResult ret = VK_PROC_DEVICE(this->instance, vkResetCommandBuffer)(cb, 0);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to reset command buffer: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+		} else {
+			const VkCommandBufferAllocateInfo allocateInfo = {
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = this->vkCommandPool,
+				.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				.commandBufferCount = 1,
+			};
+			const VkResult ret =
+				VK_PROC_DEVICE(this->instance, vkAllocateCommandBuffers)(this->instance->vkDevice, &allocateInfo, &cb);
+			if (ret != VK_SUCCESS) {
+				vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create command buffer: %s",
+						   vkm::vk::reflect::toString(ret).cStr());
+			}
+		}
+	}
+	{
+		const VkCommandBufferBeginInfo beginInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		};
+		const VkResult ret = VK_PROC_DEVICE(this->instance, vkBeginCommandBuffer)(cb, &beginInfo);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to begin command buffer: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+	}
+	for (const auto& copy : this->pendingCopies) {
+		const VkCopyBufferInfo2 copyInfo = {
+			.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
+			.srcBuffer = this->staging.vkBuffer,
+			.dstBuffer = copy.dst,
+			.regionCount = static_cast<uint32_t>(copy.regions.size()),
+			.pRegions = copy.regions.get(),
+		};
+		VK_PROC_DEVICE(this->instance, vkCmdCopyBuffer2)(cb, &copyInfo);
+	}
+	{
+		const VkResult ret = VK_PROC_DEVICE(this->instance, vkEndCommandBuffer)(cb);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to end command buffer: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+	}
+	{
+		const VkCommandBufferSubmitInfo cbInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+			.commandBuffer = cb,
+		};
+		const VkSemaphoreSubmitInfo signalInfo = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = this->semaphore.vkSemaphore,
+			.value = this->semaphore.pendingValue + 1,
+			.stageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+		};
+		const VkSubmitInfo2 submitInfo = {
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+			.commandBufferInfoCount = 1,
+			.pCommandBufferInfos = &cbInfo,
+			.signalSemaphoreInfoCount = 1,
+			.pSignalSemaphoreInfos = &signalInfo,
+		};
+		const VkResult ret = VK_PROC_DEVICE(this->instance, vkQueueSubmit2)(this->vkQueue, 1, &submitInfo, VK_NULL_HANDLE);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to submit uploads: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+	}
+
+	this->semaphore.pendingValue++;
+	this->semaphore.submitted.value.store(this->semaphore.pendingValue, vkm::std::memoryOrder::release);
+	this->segments.pushBack(segment{
+		.begin = this->staging.pendingBegin,
+		.value = this->semaphore.pendingValue,
+	});
+	this->staging.pendingBegin = this->staging.head;
+	this->commandBuffers.pushBack(vkm::std::pair{this->semaphore.pendingValue, cb});
+	this->pendingCopies.resize(0);
+	this->numPendingCopies = 0;
+	return this->semaphore.pendingValue;
+}
+}  // namespace vkm::vk
+
+extern "C" {
+VKM_FN void vkm_createUploader(vkm_device instanceHandle, vkm_string name, vkm_uploaderCreateInfo info, vkm_uploader* uploaderHandle) {
+	auto* instance = ::vkm::vk::device::instance::fromHandle(instanceHandle);
+	auto* u = new (::std::nothrow)::vkm::vk::uploader();
+
+	u->instance = instance;
+	if (name.len != 0 && name.ptr != nullptr) {
+		vkm::std::stringbuilder builder;
+		builder << name << "_uploader_" << info.queueFamily << "_" << info.queueIndex;
+		u->name = builder.str();
+	} else {
+		vkm::std::stringbuilder builder;
+		builder << "uploader_" << info.queueFamily << "_" << info.queueIndex;
+		u->name = builder.str();
+	}
+	VK_PROC_DEVICE(instance, vkGetDeviceQueue)(instance->vkDevice, info.queueFamily, info.queueIndex, &u->vkQueue);
+
+	{
+		u->semaphore.pendingValue = 0;
+		vkm_createTimelineSemaphore(instanceHandle, u->name.vkm_string(), u->semaphore.pendingValue, &u->semaphore.vkSemaphore);
+		u->semaphore.submitted.vkSemaphore = u->semaphore.vkSemaphore;
+		u->semaphore.submitted.value.store(0);
+		::vkm::vk::device::registerTimeline(instance, &u->semaphore.submitted);
+	}
+	{
+		VkPhysicalDeviceProperties properties = {};
+		VK_PROC(vkGetPhysicalDeviceProperties)(instance->vkPhysicalDevice, &properties);
+
+		u->staging.size = info.stagingSize != 0 ? info.stagingSize : VKM_UPLOADER_DEFAULT_STAGING_SIZE;
+		u->staging.alignment = vkm::std::max<VkDeviceSize>(16, properties.limits.optimalBufferCopyOffsetAlignment);
+		u->staging.head = u->staging.pendingBegin = 0;
+
+		const VkBufferCreateInfo bufferInfo = {
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = u->staging.size,
+			.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		};
+		VmaAllocationCreateInfo allocCreateInfo = {};
+		allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+		allocCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+		allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		allocCreateInfo.memoryTypeBits = instance->vma.noBARMemoryTypeBits;
+
+		VkResult ret = vmaCreateBuffer(instance->vma.allocator, &bufferInfo, &allocCreateInfo, &u->staging.vkBuffer,
+									   &u->staging.vmaAllocation, nullptr);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create staging buffer: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+		void* ptr;
+		ret = vmaMapMemory(instance->vma.allocator, u->staging.vmaAllocation, &ptr);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to map staging buffer: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+		u->staging.ptr = static_cast<uint8_t*>(ptr);
+
+		vkm::std::debugRun([=]() {
+			vkm::std::stringbuilder builder;
+			builder << u->name << "_staging";
+			vkm::vk::debugLabel(instance->vkDevice, u->staging.vkBuffer, builder.cStr());
+
+			builder.write("_allocation");
+			vmaSetAllocationName(instance->vma.allocator, u->staging.vmaAllocation, builder.cStr());
+		});
+	}
+	{
+		const VkCommandPoolCreateInfo poolInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = info.queueFamily,
+		};
+		const VkResult ret = VK_PROC_DEVICE(instance, vkCreateCommandPool)(instance->vkDevice, &poolInfo, nullptr, &u->vkCommandPool);
+		if (ret != VK_SUCCESS) {
+			vkm::fatal(vkm::std::sourceLocation::current(), "Failed to create commandpool: %s",
+					   vkm::vk::reflect::toString(ret).cStr());
+		}
+		vkm::std::debugRun([=]() {
+			vkm::std::stringbuilder builder;
+			builder << u->name << "_cmdPool";
+			vkm::vk::debugLabel(instance->vkDevice, u->vkCommandPool, builder.cStr());
+		});
+	}
+	u->numPendingCopies = 0;
+
+	*uploaderHandle = u->handle();
+}
+VKM_FN void vkm_destroyUploader(vkm_uploader uploaderHandle) {
+	auto* u = ::vkm::vk::uploader::fromHandle(uploaderHandle);
+	auto* instance = u->instance;
+
+	u->mutex.lock();
+	const uint64_t value = u->submit();
+	u->mutex.unlock();
+	vkm_semaphore_timeline_wait(instance->handle(), u->semaphore.vkSemaphore, value);
+
+	while (u->commandBuffers.size() > 0) {
+		VkCommandBuffer cb = u->commandBuffers.dequeueFront().second;
+		VK_PROC_DEVICE(instance, vkFreeCommandBuffers)(instance->vkDevice, u->vkCommandPool, 1, &cb);
+	}
+	VK_PROC_DEVICE(instance, vkDestroyCommandPool)(instance->vkDevice, u->vkCommandPool, nullptr);
+	vmaUnmapMemory(instance->vma.allocator, u->staging.vmaAllocation);
+	vmaDestroyBuffer(instance->vma.allocator, u->staging.vkBuffer, u->staging.vmaAllocation);
+	::vkm::vk::device::unregisterTimeline(instance, &u->semaphore.submitted);
+	delete u;
+}
+VKM_FN vkm_completionToken vkm_uploader_uploadBuffer(vkm_uploader uploaderHandle, VkBuffer dst, VkDeviceSize dstOffset,
+													  VkDeviceSize size, const void* data) {
+	auto* u = ::vkm::vk::uploader::fromHandle(uploaderHandle);
+	u->mutex.lock();
+	DEFER([&] { u->mutex.unlock(); });
+
+	// uploads larger than the ring are split, each piece waits for the ring to drain as needed
+	const auto* src = static_cast<const uint8_t*>(data);
+	while (size > 0) {
+		const VkDeviceSize chunk = vkm::std::min(size, u->staging.size);
+		const VkDeviceSize offset = u->allocate(chunk);
+		memcpy(u->staging.ptr + offset, src, chunk);
+		u->record(dst, offset, dstOffset, chunk);
+
+		src += chunk;
+		dstOffset += chunk;
+		size -= chunk;
+	}
+	return vkm_completionToken{
+		.vkSemaphore = u->semaphore.vkSemaphore,
+		.value = u->numPendingCopies > 0 ? u->semaphore.pendingValue + 1 : u->semaphore.pendingValue,
+	};
+}
+VKM_FN vkm_completionToken vkm_uploader_flush(vkm_uploader uploaderHandle) {
+	auto* u = ::vkm::vk::uploader::fromHandle(uploaderHandle);
+	u->mutex.lock();
+	DEFER([&] { u->mutex.unlock(); });
+
+	return vkm_completionToken{
+		.vkSemaphore = u->semaphore.vkSemaphore,
+		.value = u->submit(),
+	};
+}
+}
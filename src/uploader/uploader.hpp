@@ -0,0 +1,93 @@
+/*
+Copyright 2026 The goARRG Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#ifndef __cplusplus
+#error C++ only header
+#endif
+
+#include <stdint.h>
+
+#include "vkm/std/string.hpp"
+#include "vkm/std/vector.hpp"
+#include "vkm/std/ringbuffer.hpp"
+#include "vkm/std/thread.hpp"
+#include "vkm/std/utility.hpp"
+
+#include "vkm/vkm.h"
+#include "vkm.hpp"
+#include "device/device.hpp"
+#include "device/vma/vma.hpp"
+
+namespace vkm::vk {
+// every public function locks mutex so an uploader may be shared between threads
+struct uploader {
+	device::instance* instance;
+	vkm::std::string<char> name;
+	VkQueue vkQueue;
+	vkm::std::mutex mutex;
+
+	struct {
+		uint64_t pendingValue;
+		VkSemaphore vkSemaphore;
+		// registered on the device with the last value submitted
+		device::submittedTimeline submitted;
+	} semaphore;
+
+	struct {
+		VkBuffer vkBuffer;
+		VmaAllocation vmaAllocation;
+		uint8_t* ptr;
+		VkDeviceSize size;
+		VkDeviceSize alignment;
+		// next free byte
+		VkDeviceSize head;
+		// start of the bytes written since the last submit
+		VkDeviceSize pendingBegin;
+	} staging;
+
+	struct segment {
+		// the bytes of a submit start at begin and may wrap around to end at head of the next segment
+		VkDeviceSize begin;
+		uint64_t value;
+	};
+	// submitted but not known to be complete, oldest first
+	vkm::std::ringbuffer<segment> segments;
+
+	struct pendingCopy {
+		VkBuffer dst;
+		vkm::std::vector<VkBufferCopy2> regions;
+	};
+	vkm::std::vector<pendingCopy> pendingCopies;
+	size_t numPendingCopies;
+
+	VkCommandPool vkCommandPool;
+	// command buffers and the value of the submit they were last used in
+	vkm::std::ringbuffer<vkm::std::pair<uint64_t, VkCommandBuffer>> commandBuffers;
+
+	// frees segments whose submit has completed
+	void retire() noexcept;
+	// returns the offset of size bytes in the staging ring, submitting and waiting if it is full
+	[[nodiscard]] VkDeviceSize allocate(VkDeviceSize size) noexcept;
+	void record(VkBuffer dst, VkDeviceSize srcOffset, VkDeviceSize dstOffset, VkDeviceSize size) noexcept;
+	// submits every pending copy, returns the value the submit signals
+	uint64_t submit() noexcept;
+
+	[[nodiscard]] vkm_uploader handle() noexcept { return reinterpret_cast<vkm_uploader>(this); }
+	[[nodiscard]] static uploader* fromHandle(vkm_uploader handle) noexcept { return reinterpret_cast<uploader*>(handle); }
+};
+}  // namespace vkm::vk
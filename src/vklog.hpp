@@ -142,6 +142,11 @@ inline static void debugLabel(VkDevice vkDevice, VkCommandPool pool, const char*
 	debugLabel(vkDevice, VK_OBJECT_TYPE_COMMAND_POOL, reinterpret_cast<uint64_t>(pool), fmt, args...);
 }
 
+template <typename... Args>
+inline static void debugLabel(VkDevice vkDevice, VkQueryPool pool, const char* fmt, Args... args) noexcept {
+	debugLabel(vkDevice, VK_OBJECT_TYPE_QUERY_POOL, reinterpret_cast<uint64_t>(pool), fmt, args...);
+}
+
 template <typename... Args>
 inline static void debugLabel(VkDevice vkDevice, VkBuffer buffer, const char* fmt, Args... args) noexcept {
 	debugLabel(vkDevice, VK_OBJECT_TYPE_BUFFER, reinterpret_cast<uint64_t>(buffer), fmt, args...);